@@ -1,49 +1,93 @@
 #include "GameOfLife.h"
 #include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define NNEIGH_ONE_SIDE 3
+#define CACHE_LINE 64
 
 #define forEachCell(X, Y)                                                      \
-  for (y_t Y = 0; Y < SIM_Y; ++Y)                                              \
-    for (x_t X = 0; X < SIM_X; ++X)
-
-#define forRow(XBegin, L, X, ACTION)                                           \
-  do {                                                                         \
-    assert(L < SIM_X);                                                         \
-    for (x_t i = 0; i < L; ++i)                                                \
-      do {                                                                     \
-        x_t X = (XBegin + i) % L;                                              \
-        do {                                                                   \
-          ACTION;                                                              \
-        } while (0);                                                           \
-      } while (0);                                                             \
-  } while (0);
-
-static cell_t getNextState(cell_t *Field, x_t X, y_t Y);
-static neighbour_count_t countNeighbours(cell_t *Field, x_t X, y_t Y);
+  for (y_t Y = 0; Y < SimY; ++Y)                                               \
+    for (x_t X = 0; X < SimX; ++X)
 
 static cell_t *getCell(cell_t *Field, x_t X, y_t Y) {
-  assert(X < SIM_X);
-  assert(Y < SIM_Y);
-  return &Field[Y * SIM_X + X];
+  assert(X < SimX);
+  assert(Y < SimY);
+  return &Field[Y * SimX + X];
 }
 
 static cell_t getCellVal(cell_t *Field, x_t X, y_t Y) {
-  assert(X < SIM_X);
-  assert(Y < SIM_Y);
-  return Field[Y * SIM_X + X];
+  assert(X < SimX);
+  assert(Y < SimY);
+  return Field[Y * SimX + X];
 }
 
-static x_t getLeft(x_t X) { return (X ? X : SIM_X) - 1; }
+static x_t getLeft(x_t X) { return (X ? X : SimX) - 1; }
 
-static x_t getRight(x_t X) { return (X + 1) % SIM_X; }
+static x_t getRight(x_t X) { return (X + 1) % SimX; }
 
-static y_t getUp(y_t Y) { return (Y ? Y : SIM_Y) - 1; }
+static y_t getUp(y_t Y) { return (Y ? Y : SimY) - 1; }
 
-static y_t getDown(y_t Y) { return (Y + 1) % SIM_Y; }
+static y_t getDown(y_t Y) { return (Y + 1) % SimY; }
 
 static int cellToInt(cell_t Val) { return (Val == ALIVE) ? 1 : 0; }
 
+x_t SimX = SIM_X;
+y_t SimY = SIM_Y;
+unsigned SimWordsX = (SIM_X + 63) / 64;
+
+int setBoardSize(x_t X, y_t Y) {
+  if (X < SIM_MIN_X || Y == 0 || X > UINT_MAX - 63)
+    return 1;
+  SimX = X;
+  SimY = Y;
+  SimWordsX = (X + 63) / 64;
+  resetSparse();
+  return 0;
+}
+
+int parseUnsigned(const char *Str, unsigned long Max, unsigned long *Res) {
+  char *End;
+  errno = 0;
+  unsigned long Val = strtoul(Str, &End, 10);
+  if (!isdigit((unsigned char)*Str) || *End || errno || Val > Max)
+    return 1;
+  *Res = Val;
+  return 0;
+}
+
+int parseBoardSize(const char *X, const char *Y) {
+  unsigned long Width, Height;
+  if (parseUnsigned(X, UINT_MAX, &Width) ||
+      parseUnsigned(Y, UINT_MAX, &Height))
+    return 1;
+  return setBoardSize(Width, Height);
+}
+
+static void *allocAligned(size_t Size) {
+  void *Res = aligned_alloc(CACHE_LINE, (Size + CACHE_LINE - 1) / CACHE_LINE *
+                                            CACHE_LINE);
+  if (!Res) {
+    fprintf(stderr, "Error: cannot allocate %zu bytes for a %ux%u board\n",
+            Size, SimX, SimY);
+    exit(1);
+  }
+  return Res;
+}
+
+cell_t *allocField() {
+  return allocAligned((size_t)SimX * SimY * sizeof(cell_t));
+}
+
+word_t *allocPacked() {
+  return allocAligned((size_t)SimWordsX * SimY * sizeof(word_t));
+}
+
+void freeField(void *Field) { free(Field); }
+
 const struct SIM_Color ALIVE_COLOR = {255, 255, 255, 255};
 const struct SIM_Color DEAD_COLOR = {0, 0, 0, 255};
 
@@ -60,13 +104,89 @@ void seedGen(cell_t *Field) {
   forEachCell(X, Y) { *getCell(Field, X, Y) = simRand() % CELL_T_END; }
 }
 
+void seedGenPacked(word_t *Packed) {
+  memset(Packed, 0, (size_t)SimWordsX * SimY * sizeof(word_t));
+  forEachCell(X, Y) {
+    if (simRand() % CELL_T_END == ALIVE)
+      Packed[(size_t)Y * SimWordsX + X / 64] |= (word_t)1 << (X % 64);
+  }
+}
+
+rule_t SimRule = {0x008, 0x00C};
+
+// Next state indexed by a 3x3 neighbourhood, where bit 3 * Column + Row is
+// the cell in that column and row, so the centre cell is bit 4.
+static cell_t RuleTable[1 << 9];
+static int HasRuleTable;
+
+static void buildRuleTable() {
+  for (unsigned Idx = 0; Idx < sizeof(RuleTable) / sizeof(*RuleTable);
+       ++Idx) {
+    unsigned NNeighbours = __builtin_popcount(Idx & ~(1u << 4));
+    uint16_t Mask = (Idx >> 4) & 1 ? SimRule.Survive : SimRule.Birth;
+    RuleTable[Idx] = (Mask >> NNeighbours) & 1 ? ALIVE : DEAD;
+  }
+  HasRuleTable = 1;
+}
+
+#define RULE_NAME(NAME, BIRTH, SURVIVE) {#NAME, {BIRTH, SURVIVE}},
+static const struct {
+  const char *Name;
+  rule_t Rule;
+} RuleNames[] = {FOR_EACH_RULE(RULE_NAME)};
+#undef RULE_NAME
+
+static const char *parseCounts(const char *Str, char Prefix, uint16_t *Mask) {
+  if (toupper((unsigned char)*Str) != Prefix)
+    return NULL;
+  *Mask = 0;
+  for (++Str; *Str >= '0' && *Str <= '8'; ++Str)
+    *Mask |= 1u << (*Str - '0');
+  return Str;
+}
+
+int parseRule(const char *Str, rule_t *Rule) {
+  for (size_t I = 0; I < sizeof(RuleNames) / sizeof(*RuleNames); ++I) {
+    if (!strcmp(Str, RuleNames[I].Name)) {
+      *Rule = RuleNames[I].Rule;
+      return 0;
+    }
+  }
+  if (!(Str = parseCounts(Str, 'B', &Rule->Birth)) || *Str++ != '/' ||
+      !(Str = parseCounts(Str, 'S', &Rule->Survive)))
+    return 1;
+  return *Str != '\0';
+}
+
+void setRule(rule_t Rule) {
+  SimRule = Rule;
+  buildRuleTable();
+  selectPackedRule();
+  resetSparse();
+}
+
+static unsigned getColumn(cell_t *Field, x_t X, y_t Y) {
+  return cellToInt(getCellVal(Field, X, getUp(Y))) |
+         cellToInt(getCellVal(Field, X, Y)) << 1 |
+         cellToInt(getCellVal(Field, X, getDown(Y))) << 2;
+}
+
 void step(cell_t *Prev, cell_t *Next) {
-  forEachCell(X, Y) { *getCell(Next, X, Y) = getNextState(Prev, X, Y); }
+  if (!HasRuleTable)
+    buildRuleTable();
+  for (y_t Y = 0; Y < SimY; ++Y) {
+    unsigned Idx = getColumn(Prev, getLeft(0), Y) | getColumn(Prev, 0, Y) << 3;
+    for (x_t X = 0; X < SimX; ++X) {
+      Idx |= getColumn(Prev, getRight(X), Y) << 6;
+      *getCell(Next, X, Y) = RuleTable[Idx];
+      Idx >>= 3;
+    }
+  }
 }
 
 void fillImgBuffer(cell_t *Field) {
-  const unsigned XScale = IMG_X / SIM_X;
-  const unsigned YScale = IMG_Y / SIM_Y;
+  const unsigned XScale = IMG_X / SimX;
+  const unsigned YScale = IMG_Y / SimY;
   forEachCell(X, Y) {
     for (unsigned Yi = 0; Yi < YScale; ++Yi)
       for (unsigned Xi = 0; Xi < XScale; ++Xi)
@@ -76,24 +196,11 @@ void fillImgBuffer(cell_t *Field) {
   simFlush();
 }
 
-cell_t getNextState(cell_t *Field, const x_t X, const y_t Y) {
-  neighbour_count_t NNeighbours = countNeighbours(Field, X, Y);
-  if (NNeighbours >= ALIVE_MIN && NNeighbours < OVERPOP_MIN) {
-    if (NNeighbours >= REPRODUCE_MIN)
-      return ALIVE;
-    else
-      return getCellVal(Field, X, Y);
-  }
-  return DEAD;
-}
+void initFrames() { simInitFrames(SimX, SimY, ALIVE_COLOR, DEAD_COLOR); }
 
-neighbour_count_t countNeighbours(cell_t *Field, const x_t X, const y_t Y) {
-  int Res = 0;
-  forRow(getLeft(X), NNEIGH_ONE_SIDE, XI,
-         Res += cellToInt(getCellVal(Field, XI, getUp(Y)));) Res +=
-      cellToInt(getCellVal(Field, getLeft(X), Y));
-  Res += cellToInt(getCellVal(Field, getRight(X), Y));
-  forRow(getLeft(X), NNEIGH_ONE_SIDE, XI,
-         Res += cellToInt(getCellVal(Field, XI, getDown(Y))););
-  return Res;
+void publishFrame(word_t *Field) {
+  if (!simWantsFrame())
+    return;
+  memcpy(simGetBackFrame(), Field, (size_t)SimWordsX * SimY * sizeof(word_t));
+  simPublishFrame();
 }
@@ -1,25 +1,98 @@
 #pragma once
 #include "sim.h"
+#include <stddef.h>
+#include <stdint.h>
 
+// Default board size, can be changed at runtime with setBoardSize.
 #ifndef SIM_X
 #define SIM_X 10
 #endif
 #ifndef SIM_Y
 #define SIM_Y 10
 #endif
+// Narrowest board the engines support.
+#define SIM_MIN_X 4
 
 typedef enum { DEAD, ALIVE, CELL_T_END } cell_t;
 
-typedef enum {
-  ALIVE_MIN = 2,
-  REPRODUCE_MIN = 3,
-  OVERPOP_MIN = 4,
-  NEIGHBOUR_COUNT_T_MAX = 8
-} neighbour_count_t;
+// Outer-totalistic rule: bit N of Birth (Survive) is set if a dead (live)
+// cell with N live neighbours is alive in the next generation.
+typedef struct {
+  uint16_t Birth;
+  uint16_t Survive;
+} rule_t;
+
+// Rules the packed engines have kernels specialized at compile time for,
+// X(Name, Birth, Survive). Any other rule runs through a generic kernel.
+#define FOR_EACH_RULE(X)                                                       \
+  X(Life, 0x008, 0x00C)                                                        \
+  X(HighLife, 0x048, 0x00C)                                                    \
+  X(DayAndNight, 0x1C8, 0x1D8)                                                 \
+  X(Seeds, 0x004, 0x000)                                                       \
+  X(Replicator, 0x0AA, 0x0AA)
 
 typedef unsigned x_t;
 typedef unsigned y_t;
 
+// Bit-packed field: one bit per cell, SimWordsX words per row.
+typedef uint64_t word_t;
+
+extern x_t SimX;
+extern y_t SimY;
+extern unsigned SimWordsX;
+
+// Fields are heap allocated and cache-line aligned. Resizing the board
+// invalidates all fields allocated before. Running out of memory is reported
+// and exits.
+// Both return 0 on success and leave the size unchanged otherwise.
+int setBoardSize(x_t X, y_t Y);
+int parseBoardSize(const char *X, const char *Y);
+// Accepts decimal digits only, up to Max. Returns 0 on success.
+int parseUnsigned(const char *Str, unsigned long Max, unsigned long *Res);
+cell_t *allocField();
+word_t *allocPacked();
+void freeField(void *Field);
+
+extern rule_t SimRule;
+
+// Accepts "B3/S23" notation as well as the names from FOR_EACH_RULE.
+// Returns 0 on success.
+int parseRule(const char *Str, rule_t *Rule);
+void setRule(rule_t Rule);
+void selectPackedRule();
+
 void seedGen(cell_t *Field);
+// Same cells as seedGen from the same simRand state, without a cell_t field.
+void seedGenPacked(word_t *Packed);
 void step(cell_t *Prev, cell_t *Next);
 void fillImgBuffer(cell_t *Field);
+void initFrames();
+// Hands a packed field to the backend renderer if it is ready for a new
+// frame, otherwise does nothing.
+void publishFrame(word_t *Field);
+
+void packField(cell_t *Field, word_t *Packed);
+void unpackField(word_t *Packed, cell_t *Field);
+void stepPacked(word_t *Prev, word_t *Next);
+void stepPackedRow(word_t *Up, word_t *Mid, word_t *Down, word_t *Res);
+word_t stepPackedWord(word_t *Up, word_t *Mid, word_t *Down, unsigned W);
+
+// NThreads == 0 means one thread per online CPU.
+void setThreadCount(unsigned NThreads);
+// Advances the packed field by Generations and stores the result in Next.
+// Generations > 1 are fused per band at the cost of recomputing a halo.
+void stepParallel(word_t *Prev, word_t *Next, unsigned Generations);
+
+// Recomputes only tiles that changed in the previous generation or border
+// one that did. Relies on being called with alternating Prev/Next buffers;
+// call resetSparse after modifying a field by other means.
+void resetSparse();
+void stepSparse(word_t *Prev, word_t *Next);
+
+// HashLife: advances Prev by 2^Log2Gens generations into Next. Memoized
+// results are kept between calls. The node cache never grows past its limit:
+// a jump that would need more is abandoned, the cache flushed and the
+// generations computed as smaller jumps, down to single generations stepped
+// with stepPacked. Running out of memory is handled the same way.
+void setHashLifeCacheLimit(size_t Bytes);
+void stepHashLife(word_t *Prev, word_t *Next, unsigned Log2Gens);
@@ -0,0 +1,400 @@
+#include "GameOfLife.h"
+#include "LifeKernel.h"
+#include <assert.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Quadtree nodes are hash-consed, so equal regions share one node and the
+// memoized successor of a node is reused wherever the region occurs. Leaves
+// are 8x8 blocks (level 3) stored as one word, bit Y * 8 + X per cell.
+#define LEAF_LEVEL 3
+#define LEAF_SIZE 8
+#define MIN_LEVEL 5
+#define MAX_LEVEL 62
+#define DEFAULT_CACHE_BYTES ((size_t)1 << 30)
+#define INITIAL_NODES 1024
+
+typedef uint32_t node_id_t;
+
+struct Node {
+  node_id_t Child[4]; // NW, NE, SW, SE.
+  word_t Bits;        // Leaves only.
+  node_id_t Result;   // Memoized successor for ResultLog2Gens, 0 if none.
+  node_id_t HashNext;
+  unsigned char Level;
+  unsigned char ResultLog2Gens;
+};
+
+enum { NW, NE, SW, SE };
+
+// Node 0 is reserved as a null id. Growing the cache past Limit, or failing
+// to, jumps to Overflow, which abandons the jump being computed.
+static struct {
+  struct Node *Nodes;
+  node_id_t NNodes;
+  node_id_t Capacity;
+  node_id_t *Buckets;
+  node_id_t NBuckets;
+  size_t Limit;
+  rule_t Rule; // The rule memoized results were computed under.
+  jmp_buf Overflow;
+} Cache = {.Limit = DEFAULT_CACHE_BYTES};
+
+DEFINE_RULE_KERNEL(ruleRow, uint32_t)
+#undef DEFINE_RULE_KERNEL
+#undef RULE_TERM
+
+static size_t getCacheBytes() {
+  return Cache.Capacity * sizeof(struct Node) +
+         Cache.NBuckets * sizeof(node_id_t);
+}
+
+static void flushCache() {
+  free(Cache.Nodes);
+  free(Cache.Buckets);
+  Cache.Nodes = NULL;
+  Cache.Buckets = NULL;
+  Cache.NNodes = Cache.Capacity = Cache.NBuckets = 0;
+}
+
+static uint64_t hashNode(unsigned Level, node_id_t *Child, word_t Bits) {
+  uint64_t H = Bits ^ Level;
+  for (unsigned I = 0; I < 4; ++I)
+    H = (H ^ Child[I]) * 0x9E3779B97F4A7C15ULL;
+  return H ^ (H >> 29);
+}
+
+static void reserveBytes(size_t Bytes) {
+  if (Bytes > Cache.Limit || getCacheBytes() > Cache.Limit - Bytes)
+    longjmp(Cache.Overflow, 1);
+}
+
+static void rehash(node_id_t NBuckets) {
+  reserveBytes((size_t)(NBuckets - Cache.NBuckets) * sizeof(node_id_t));
+  node_id_t *Buckets = calloc(NBuckets, sizeof(node_id_t));
+  if (!Buckets)
+    longjmp(Cache.Overflow, 1);
+  free(Cache.Buckets);
+  Cache.Buckets = Buckets;
+  Cache.NBuckets = NBuckets;
+  for (node_id_t Id = 1; Id < Cache.NNodes; ++Id) {
+    struct Node *N = &Cache.Nodes[Id];
+    node_id_t *Bucket =
+        &Cache.Buckets[hashNode(N->Level, N->Child, N->Bits) % NBuckets];
+    N->HashNext = *Bucket;
+    *Bucket = Id;
+  }
+}
+
+// Makes room for Capacity nodes.
+static void growNodes(node_id_t Capacity) {
+  reserveBytes((size_t)(Capacity - Cache.Capacity) * sizeof(struct Node));
+  struct Node *Nodes = realloc(Cache.Nodes, Capacity * sizeof(struct Node));
+  if (!Nodes)
+    longjmp(Cache.Overflow, 1);
+  Cache.Nodes = Nodes;
+  Cache.Capacity = Capacity;
+}
+
+static node_id_t getNode(unsigned Level, node_id_t *Child, word_t Bits) {
+  if (!Cache.Nodes) {
+    growNodes(INITIAL_NODES);
+    Cache.NNodes = 1;
+    rehash(INITIAL_NODES);
+  }
+
+  uint64_t Hash = hashNode(Level, Child, Bits);
+  for (node_id_t Id = Cache.Buckets[Hash % Cache.NBuckets]; Id;
+       Id = Cache.Nodes[Id].HashNext) {
+    struct Node *N = &Cache.Nodes[Id];
+    if (N->Level == Level && N->Bits == Bits &&
+        !memcmp(N->Child, Child, sizeof(N->Child)))
+      return Id;
+  }
+
+  if (Cache.NNodes == Cache.Capacity) {
+    if (Cache.Capacity > UINT32_MAX / 2)
+      longjmp(Cache.Overflow, 1);
+    growNodes(2 * Cache.Capacity);
+  }
+  node_id_t Id = Cache.NNodes++;
+  struct Node *N = &Cache.Nodes[Id];
+  memcpy(N->Child, Child, sizeof(N->Child));
+  N->Bits = Bits;
+  N->Result = 0;
+  N->Level = Level;
+  node_id_t *Bucket = &Cache.Buckets[Hash % Cache.NBuckets];
+  N->HashNext = *Bucket;
+  *Bucket = Id;
+  if (Cache.NNodes > Cache.NBuckets)
+    rehash(2 * Cache.NBuckets);
+  return Id;
+}
+
+static node_id_t getLeaf(word_t Bits) {
+  node_id_t NoChildren[4] = {0};
+  return getNode(LEAF_LEVEL, NoChildren, Bits);
+}
+
+static node_id_t join(node_id_t NWId, node_id_t NEId, node_id_t SWId,
+                      node_id_t SEId) {
+  node_id_t Child[4] = {NWId, NEId, SWId, SEId};
+  return getNode(Cache.Nodes[NWId].Level + 1, Child, 0);
+}
+
+static node_id_t getChild(node_id_t Id, unsigned Quadrant) {
+  return Cache.Nodes[Id].Child[Quadrant];
+}
+
+static word_t getBits(node_id_t Id) { return Cache.Nodes[Id].Bits; }
+
+// Centre 8x8 block of a level 4 node after Gens <= 4 generations. Cells
+// outside the node are taken as dead, which cannot reach the centre in time.
+static node_id_t stepBase(node_id_t Id, unsigned Gens) {
+  uint32_t Rows[2][2 * LEAF_SIZE];
+  for (unsigned Y = 0; Y < LEAF_SIZE; ++Y) {
+    unsigned Shift = Y * LEAF_SIZE;
+    Rows[0][Y] = ((getBits(getChild(Id, NW)) >> Shift) & 0xFF) |
+                 ((getBits(getChild(Id, NE)) >> Shift) & 0xFF) << LEAF_SIZE;
+    Rows[0][Y + LEAF_SIZE] =
+        ((getBits(getChild(Id, SW)) >> Shift) & 0xFF) |
+        ((getBits(getChild(Id, SE)) >> Shift) & 0xFF) << LEAF_SIZE;
+  }
+
+  unsigned Cur = 0;
+  for (unsigned Gen = 0; Gen < Gens; ++Gen, Cur ^= 1) {
+    uint32_t *Src = Rows[Cur], *Dst = Rows[Cur ^ 1];
+    Dst[0] = Dst[2 * LEAF_SIZE - 1] = 0;
+    for (unsigned Y = 1; Y + 1 < 2 * LEAF_SIZE; ++Y)
+      Dst[Y] = ruleRow(Src[Y - 1] << 1, Src[Y - 1], Src[Y - 1] >> 1,
+                       Src[Y] << 1, Src[Y], Src[Y] >> 1, Src[Y + 1] << 1,
+                       Src[Y + 1], Src[Y + 1] >> 1, SimRule.Birth,
+                       SimRule.Survive);
+  }
+
+  word_t Bits = 0;
+  for (unsigned Y = 0; Y < LEAF_SIZE; ++Y)
+    Bits |= (word_t)((Rows[Cur][Y + LEAF_SIZE / 2] >> LEAF_SIZE / 2) & 0xFF)
+            << (Y * LEAF_SIZE);
+  return getLeaf(Bits);
+}
+
+static node_id_t getCentre(node_id_t Id) {
+  if (Cache.Nodes[Id].Level == LEAF_LEVEL + 1)
+    return stepBase(Id, 0);
+  return join(getChild(getChild(Id, NW), SE), getChild(getChild(Id, NE), SW),
+              getChild(getChild(Id, SW), NE), getChild(getChild(Id, SE), NW));
+}
+
+// Centre half of a level L node after 2^Log2Gens generations,
+// Log2Gens <= L - 2.
+static node_id_t getSuccessor(node_id_t Id, unsigned Log2Gens) {
+  struct Node *N = &Cache.Nodes[Id];
+  const unsigned Level = N->Level;
+  assert(Log2Gens + 2 <= Level);
+  if (N->Result && N->ResultLog2Gens == Log2Gens)
+    return N->Result;
+
+  node_id_t Res;
+  if (Level == LEAF_LEVEL + 1) {
+    Res = stepBase(Id, 1u << Log2Gens);
+  } else {
+    node_id_t C[4];
+    memcpy(C, N->Child, sizeof(C));
+    node_id_t Sub[3][3] = {
+        {C[NW],
+         join(getChild(C[NW], NE), getChild(C[NE], NW), getChild(C[NW], SE),
+              getChild(C[NE], SW)),
+         C[NE]},
+        {join(getChild(C[NW], SW), getChild(C[NW], SE), getChild(C[SW], NW),
+              getChild(C[SW], NE)),
+         join(getChild(C[NW], SE), getChild(C[NE], SW), getChild(C[SW], NE),
+              getChild(C[SE], NW)),
+         join(getChild(C[NE], SW), getChild(C[NE], SE), getChild(C[SE], NW),
+              getChild(C[SE], NE))},
+        {C[SW],
+         join(getChild(C[SW], NE), getChild(C[SE], NW), getChild(C[SW], SE),
+              getChild(C[SE], SW)),
+         C[SE]}};
+
+    // A full-size step spends half of the generations on the overlapping
+    // sub-nodes and the other half on their combination. A shorter one only
+    // crops the sub-nodes first.
+    const int IsFullStep = (Log2Gens + 2 == Level);
+    const unsigned SubLog2Gens = IsFullStep ? Log2Gens - 1 : Log2Gens;
+    for (unsigned Y = 0; Y < 3; ++Y)
+      for (unsigned X = 0; X < 3; ++X)
+        Sub[Y][X] = IsFullStep ? getSuccessor(Sub[Y][X], SubLog2Gens)
+                               : getCentre(Sub[Y][X]);
+
+    Res = join(
+        getSuccessor(join(Sub[0][0], Sub[0][1], Sub[1][0], Sub[1][1]),
+                     SubLog2Gens),
+        getSuccessor(join(Sub[0][1], Sub[0][2], Sub[1][1], Sub[1][2]),
+                     SubLog2Gens),
+        getSuccessor(join(Sub[1][0], Sub[1][1], Sub[2][0], Sub[2][1]),
+                     SubLog2Gens),
+        getSuccessor(join(Sub[1][1], Sub[1][2], Sub[2][1], Sub[2][2]),
+                     SubLog2Gens));
+  }
+
+  // The node array may have been reallocated by the recursion.
+  N = &Cache.Nodes[Id];
+  N->Result = Res;
+  N->ResultLog2Gens = Log2Gens;
+  return Res;
+}
+
+static long wrap(long V, long Size) {
+  V %= Size;
+  return V < 0 ? V + Size : V;
+}
+
+// LEAF_SIZE cells of a row starting at X, wrapping around the board.
+static word_t getRowBits(word_t *Field, long X, long Y) {
+  X = wrap(X, SimX);
+  word_t *Row = &Field[wrap(Y, SimY) * SimWordsX];
+  if (X + LEAF_SIZE <= SimX && X % 64 + LEAF_SIZE <= 64)
+    return (Row[X / 64] >> (X % 64)) & 0xFF;
+  word_t Bits = 0;
+  for (unsigned I = 0; I < LEAF_SIZE; ++I, X = (X + 1) % SimX)
+    Bits |= ((Row[X / 64] >> (X % 64)) & 1) << I;
+  return Bits;
+}
+
+// Node of the given level covering the torus unrolled onto the plane, with
+// its top-left corner at (X0, Y0).
+static node_id_t buildNode(word_t *Field, unsigned Level, long X0, long Y0) {
+  if (Level == LEAF_LEVEL) {
+    word_t Bits = 0;
+    for (unsigned Y = 0; Y < LEAF_SIZE; ++Y)
+      Bits |= getRowBits(Field, X0, Y0 + Y) << (Y * LEAF_SIZE);
+    return getLeaf(Bits);
+  }
+  long Half = 1L << (Level - 1);
+  return join(buildNode(Field, Level - 1, X0, Y0),
+              buildNode(Field, Level - 1, X0 + Half, Y0),
+              buildNode(Field, Level - 1, X0, Y0 + Half),
+              buildNode(Field, Level - 1, X0 + Half, Y0 + Half));
+}
+
+// Writes the part of a node with its top-left corner at (X0, Y0) that falls
+// onto the board.
+static void writeNode(word_t *Field, node_id_t Id, long X0, long Y0) {
+  if (X0 >= SimX || Y0 >= SimY)
+    return;
+  unsigned Level = Cache.Nodes[Id].Level;
+  if (Level == LEAF_LEVEL) {
+    word_t Bits = getBits(Id);
+    for (unsigned Y = 0; Y < LEAF_SIZE && Y0 + Y < SimY; ++Y)
+      for (unsigned X = 0; X < LEAF_SIZE && X0 + X < SimX; ++X) {
+        word_t *W = &Field[(Y0 + Y) * SimWordsX + (X0 + X) / 64];
+        word_t Mask = (word_t)1 << ((X0 + X) % 64);
+        *W = (Bits >> (Y * LEAF_SIZE + X)) & 1 ? *W | Mask : *W & ~Mask;
+      }
+    return;
+  }
+  long Half = 1L << (Level - 1);
+  writeNode(Field, getChild(Id, NW), X0, Y0);
+  writeNode(Field, getChild(Id, NE), X0 + Half, Y0);
+  writeNode(Field, getChild(Id, SW), X0, Y0 + Half);
+  writeNode(Field, getChild(Id, SE), X0 + Half, Y0 + Half);
+}
+
+static unsigned getLog2Ceil(unsigned long V) {
+  unsigned Res = 0;
+  while ((1UL << Res) < V)
+    ++Res;
+  return Res;
+}
+
+void setHashLifeCacheLimit(size_t Bytes) {
+  Cache.Limit = Bytes;
+  if (getCacheBytes() > Cache.Limit)
+    flushCache();
+}
+
+// Smallest node whose centre covers a board that is not a square power of
+// two. It is rebuilt for every jump, so jumps are at most Level - 2.
+static unsigned getJumpLevel() {
+  unsigned Level = getLog2Ceil(SimX > SimY ? SimX : SimY) + 1;
+  return Level < MIN_LEVEL ? MIN_LEVEL : Level;
+}
+
+// A square power-of-two torus tiles the plane along node boundaries, so
+// the tiling of any size is a chain of joins of the board node and the
+// centre of the result starts at a whole number of periods.
+static int isSquareTiling() {
+  const unsigned BoardLevel = getLog2Ceil(SimX);
+  return SimX == SimY && SimX == (1UL << BoardLevel) &&
+         BoardLevel >= LEAF_LEVEL;
+}
+
+// Advances Field by 2^Log2Gens generations in place. Returns 1 and leaves
+// Field and an empty cache behind if the cache would outgrow its limit.
+static int jump(word_t *Field, unsigned Log2Gens) {
+  if (setjmp(Cache.Overflow)) {
+    flushCache();
+    return 1;
+  }
+
+  node_id_t Res;
+  if (isSquareTiling()) {
+    const unsigned BoardLevel = getLog2Ceil(SimX);
+    unsigned Level = BoardLevel + 2;
+    if (Level < Log2Gens + 2)
+      Level = Log2Gens + 2;
+    node_id_t Tiling = buildNode(Field, BoardLevel, 0, 0);
+    for (unsigned L = BoardLevel; L < Level; ++L)
+      Tiling = join(Tiling, Tiling, Tiling, Tiling);
+    Res = getSuccessor(Tiling, Log2Gens);
+    while (Cache.Nodes[Res].Level > BoardLevel)
+      Res = getChild(Res, NW);
+    // Clears the padding bits past the board width as well.
+    memset(Field, 0, SimWordsX * SimY * sizeof(word_t));
+  } else {
+    const unsigned Level = getJumpLevel();
+    const long Offset = -(1L << (Level - 2));
+    assert(Log2Gens + 2 <= Level);
+    Res = getSuccessor(buildNode(Field, Level, Offset, Offset), Log2Gens);
+  }
+  writeNode(Field, Res, 0, 0);
+  return 0;
+}
+
+// Jumps that do not fit into the cache are retried with it empty, then split
+// in halves. Single generations that still do not fit are stepped without it.
+static void advance(word_t *Field, unsigned Log2Gens) {
+  if (getCacheBytes() > Cache.Limit)
+    flushCache();
+  const int WasEmpty = !Cache.Nodes;
+  if (!jump(Field, Log2Gens) || (!WasEmpty && !jump(Field, Log2Gens)))
+    return;
+  if (Log2Gens) {
+    advance(Field, Log2Gens - 1);
+    advance(Field, Log2Gens - 1);
+    return;
+  }
+  word_t *Tmp = allocPacked();
+  stepPacked(Field, Tmp);
+  memcpy(Field, Tmp, SimWordsX * SimY * sizeof(word_t));
+  freeField(Tmp);
+}
+
+void stepHashLife(word_t *Prev, word_t *Next, unsigned Log2Gens) {
+  assert(Log2Gens + 2 <= MAX_LEVEL);
+  if (Cache.Rule.Birth != SimRule.Birth ||
+      Cache.Rule.Survive != SimRule.Survive)
+    flushCache();
+  Cache.Rule = SimRule;
+
+  // On other boards longer jumps are split into several of the longest.
+  unsigned JumpLog2Gens = Log2Gens;
+  if (!isSquareTiling() && JumpLog2Gens > getJumpLevel() - 2)
+    JumpLog2Gens = getJumpLevel() - 2;
+  memcpy(Next, Prev, SimWordsX * SimY * sizeof(word_t));
+  for (unsigned long Jump = 0; Jump < 1UL << (Log2Gens - JumpLog2Gens);
+       ++Jump)
+    advance(Next, JumpLog2Gens);
+}
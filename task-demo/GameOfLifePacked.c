@@ -0,0 +1,154 @@
+#include "GameOfLife.h"
+#include "LifeKernel.h"
+#include <string.h>
+
+#define WORD_BITS 64
+#define LAST_WORD (SimWordsX - 1)
+#define LAST_BIT ((SimX - 1) % WORD_BITS)
+#define LAST_MASK (~(word_t)0 >> (WORD_BITS - 1 - LAST_BIT))
+
+// Several words processed at once: one AVX2 or SSE2 register, lowered to plain
+// scalar code on targets without either.
+#ifdef __AVX2__
+typedef word_t vword_t __attribute__((vector_size(32)));
+#else
+typedef word_t vword_t __attribute__((vector_size(16)));
+#endif
+#define VWORD_LEN (sizeof(vword_t) / sizeof(word_t))
+
+DEFINE_RULE_KERNEL(ruleWord, word_t)
+DEFINE_RULE_KERNEL(ruleVWord, vword_t)
+#undef DEFINE_RULE_KERNEL
+#undef RULE_TERM
+
+static word_t *getRow(word_t *Field, y_t Y) { return &Field[Y * SimWordsX]; }
+
+static y_t getUp(y_t Y) { return (Y ? Y : SimY) - 1; }
+
+static y_t getDown(y_t Y) { return (Y + 1) % SimY; }
+
+// Cells to the west/east of word W, wrapping around the torus at the edges.
+static word_t getWest(word_t *Row, unsigned W) {
+  word_t Carry = W ? Row[W - 1] >> (WORD_BITS - 1)
+                   : (Row[LAST_WORD] >> LAST_BIT) & 1;
+  return (Row[W] << 1) | Carry;
+}
+
+static word_t getEast(word_t *Row, unsigned W) {
+  word_t Carry = (W + 1 < SimWordsX) ? Row[W + 1] << (WORD_BITS - 1)
+                                 : (Row[0] & 1) << LAST_BIT;
+  return (Row[W] >> 1) | Carry;
+}
+
+static vword_t loadVWord(word_t *P) {
+  vword_t V;
+  memcpy(&V, P, sizeof(V));
+  return V;
+}
+
+static vword_t getVWest(word_t *Row, unsigned W) {
+  return (loadVWord(Row + W) << 1) |
+         (loadVWord(Row + W - 1) >> (WORD_BITS - 1));
+}
+
+static vword_t getVEast(word_t *Row, unsigned W) {
+  return (loadVWord(Row + W) >> 1) |
+         (loadVWord(Row + W + 1) << (WORD_BITS - 1));
+}
+
+static inline __attribute__((always_inline)) word_t
+stepWord(word_t *Up, word_t *Mid, word_t *Down, unsigned W, unsigned Birth,
+         unsigned Survive) {
+  return ruleWord(getWest(Up, W), Up[W], getEast(Up, W), getWest(Mid, W),
+                  Mid[W], getEast(Mid, W), getWest(Down, W), Down[W],
+                  getEast(Down, W), Birth, Survive);
+}
+
+static inline __attribute__((always_inline)) void
+stepRow(word_t *Up, word_t *Mid, word_t *Down, word_t *Res, unsigned Birth,
+        unsigned Survive) {
+  Res[0] = stepWord(Up, Mid, Down, 0, Birth, Survive);
+  unsigned W = 1;
+  // Interior words have both neighbouring words in the row, so no wraparound
+  // is needed there.
+  for (; W + VWORD_LEN < SimWordsX; W += VWORD_LEN) {
+    vword_t R = ruleVWord(getVWest(Up, W), loadVWord(Up + W), getVEast(Up, W),
+                          getVWest(Mid, W), loadVWord(Mid + W),
+                          getVEast(Mid, W), getVWest(Down, W),
+                          loadVWord(Down + W), getVEast(Down, W), Birth,
+                          Survive);
+    memcpy(Res + W, &R, sizeof(R));
+  }
+  for (; W < SimWordsX; ++W)
+    Res[W] = stepWord(Up, Mid, Down, W, Birth, Survive);
+  Res[LAST_WORD] &= LAST_MASK;
+}
+
+// Row and word steppers with the rule baked in for each of FOR_EACH_RULE, and
+// a generic pair reading it from SimRule.
+#define DEFINE_RULE_STEPPERS(NAME, BIRTH, SURVIVE)                             \
+  static void stepRow##NAME(word_t *Up, word_t *Mid, word_t *Down,             \
+                            word_t *Res) {                                     \
+    stepRow(Up, Mid, Down, Res, BIRTH, SURVIVE);                               \
+  }                                                                            \
+  static word_t stepWord##NAME(word_t *Up, word_t *Mid, word_t *Down,          \
+                               unsigned W) {                                   \
+    return stepWord(Up, Mid, Down, W, BIRTH, SURVIVE);                         \
+  }
+FOR_EACH_RULE(DEFINE_RULE_STEPPERS)
+DEFINE_RULE_STEPPERS(Generic, SimRule.Birth, SimRule.Survive)
+
+struct RuleSteppers {
+  rule_t Rule;
+  void (*StepRow)(word_t *Up, word_t *Mid, word_t *Down, word_t *Res);
+  word_t (*StepWord)(word_t *Up, word_t *Mid, word_t *Down, unsigned W);
+};
+
+#define RULE_STEPPERS(NAME, BIRTH, SURVIVE)                                    \
+  {{BIRTH, SURVIVE}, stepRow##NAME, stepWord##NAME},
+static const struct RuleSteppers Specialized[] = {FOR_EACH_RULE(RULE_STEPPERS)};
+static const struct RuleSteppers Generic = {{0, 0}, stepRowGeneric,
+                                            stepWordGeneric};
+#undef RULE_STEPPERS
+
+// Starts out as the first rule of FOR_EACH_RULE, which is SimRule's default.
+static const struct RuleSteppers *Steppers = Specialized;
+
+void selectPackedRule() {
+  Steppers = &Generic;
+  for (size_t I = 0; I < sizeof(Specialized) / sizeof(*Specialized); ++I)
+    if (Specialized[I].Rule.Birth == SimRule.Birth &&
+        Specialized[I].Rule.Survive == SimRule.Survive)
+      Steppers = &Specialized[I];
+}
+
+void packField(cell_t *Field, word_t *Packed) {
+  memset(Packed, 0, SimY * SimWordsX * sizeof(word_t));
+  for (y_t Y = 0; Y < SimY; ++Y)
+    for (x_t X = 0; X < SimX; ++X)
+      if (Field[Y * SimX + X] == ALIVE)
+        getRow(Packed, Y)[X / WORD_BITS] |= (word_t)1 << (X % WORD_BITS);
+}
+
+void unpackField(word_t *Packed, cell_t *Field) {
+  for (y_t Y = 0; Y < SimY; ++Y)
+    for (x_t X = 0; X < SimX; ++X)
+      Field[Y * SimX + X] =
+          (getRow(Packed, Y)[X / WORD_BITS] >> (X % WORD_BITS)) & 1 ? ALIVE
+                                                                    : DEAD;
+}
+
+void stepPackedRow(word_t *Up, word_t *Mid, word_t *Down, word_t *Res) {
+  Steppers->StepRow(Up, Mid, Down, Res);
+}
+
+word_t stepPackedWord(word_t *Up, word_t *Mid, word_t *Down, unsigned W) {
+  word_t Res = Steppers->StepWord(Up, Mid, Down, W);
+  return (W == LAST_WORD) ? Res & LAST_MASK : Res;
+}
+
+void stepPacked(word_t *Prev, word_t *Next) {
+  for (y_t Y = 0; Y < SimY; ++Y)
+    stepPackedRow(getRow(Prev, getUp(Y)), getRow(Prev, Y),
+                  getRow(Prev, getDown(Y)), getRow(Next, Y));
+}
@@ -0,0 +1,147 @@
+#include "GameOfLife.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Band height is chosen so that a band of both buffers stays in L2. make check
+// lowers it so that small boards are split into several bands too.
+#ifndef BAND_BYTES
+#define BAND_BYTES (128 * 1024)
+#endif
+
+struct Job {
+  word_t *Prev;
+  word_t *Next;
+  unsigned Generations;
+  int Quit;
+};
+
+// The calling thread works as one of NThreads pool members.
+static struct {
+  unsigned NThreads;
+  pthread_t *Workers;
+  pthread_barrier_t Start;
+  pthread_barrier_t Done;
+  struct Job Job;
+  atomic_uint NextBand;
+} Pool;
+
+static _Thread_local word_t *Scratch;
+static _Thread_local size_t ScratchWords;
+
+static word_t *getScratch(size_t NWords) {
+  if (NWords > ScratchWords) {
+    free(Scratch);
+    Scratch = malloc(NWords * sizeof(word_t));
+    ScratchWords = NWords;
+  }
+  return Scratch;
+}
+
+static word_t *getRow(word_t *Field, y_t Y) { return &Field[Y * SimWordsX]; }
+
+static y_t wrapY(long Y) {
+  Y %= SimY;
+  return Y < 0 ? Y + SimY : Y;
+}
+
+static unsigned getBandHeight() {
+  unsigned H = BAND_BYTES / (2 * SimWordsX * sizeof(word_t));
+  return H ? (H < SimY ? H : SimY) : 1;
+}
+
+// Rows [Y0, Y1) of Next after K generations. For K > 1 the band is extended
+// by a K-row halo and stepped in scratch, each generation shrinking the valid
+// region by a row on both sides.
+static void stepBand(struct Job *J, y_t Y0, y_t Y1) {
+  const unsigned K = J->Generations;
+  if (K == 1) {
+    for (y_t Y = Y0; Y < Y1; ++Y)
+      stepPackedRow(getRow(J->Prev, wrapY((long)Y - 1)), getRow(J->Prev, Y),
+                    getRow(J->Prev, wrapY(Y + 1)), getRow(J->Next, Y));
+    return;
+  }
+
+  const unsigned H = Y1 - Y0 + 2 * K;
+  word_t *Buf[2];
+  Buf[0] = getScratch(2 * H * SimWordsX);
+  Buf[1] = Buf[0] + H * SimWordsX;
+  for (unsigned R = 0; R < H; ++R)
+    memcpy(getRow(Buf[0], R), getRow(J->Prev, wrapY((long)Y0 + R - K)),
+           SimWordsX * sizeof(word_t));
+
+  for (unsigned Gen = 1; Gen <= K; ++Gen) {
+    word_t *Src = Buf[(Gen - 1) & 1];
+    for (unsigned R = Gen; R < H - Gen; ++R) {
+      word_t *Res = (Gen == K) ? getRow(J->Next, Y0 + R - K)
+                               : getRow(Buf[Gen & 1], R);
+      stepPackedRow(getRow(Src, R - 1), getRow(Src, R), getRow(Src, R + 1),
+                    Res);
+    }
+  }
+}
+
+static void runBands() {
+  const unsigned BandH = getBandHeight();
+  const unsigned NBands = (SimY + BandH - 1) / BandH;
+  for (unsigned Band; (Band = atomic_fetch_add(&Pool.NextBand, 1)) < NBands;) {
+    y_t Y0 = Band * BandH;
+    y_t Y1 = (Y0 + BandH < SimY) ? Y0 + BandH : SimY;
+    stepBand(&Pool.Job, Y0, Y1);
+  }
+}
+
+static void *workerMain(void *Arg) {
+  (void)Arg;
+  for (;;) {
+    pthread_barrier_wait(&Pool.Start);
+    if (Pool.Job.Quit)
+      break;
+    runBands();
+    pthread_barrier_wait(&Pool.Done);
+  }
+  free(Scratch);
+  return NULL;
+}
+
+void setThreadCount(unsigned NThreads) {
+  if (Pool.NThreads) {
+    Pool.Job.Quit = 1;
+    pthread_barrier_wait(&Pool.Start);
+    for (unsigned I = 0; I + 1 < Pool.NThreads; ++I)
+      pthread_join(Pool.Workers[I], NULL);
+    pthread_barrier_destroy(&Pool.Start);
+    pthread_barrier_destroy(&Pool.Done);
+    free(Pool.Workers);
+    Pool.Job.Quit = 0;
+    // The workers free their scratch on exit, this is the calling thread's.
+    free(Scratch);
+    Scratch = NULL;
+    ScratchWords = 0;
+  }
+
+  if (!NThreads) {
+    long NCPU = sysconf(_SC_NPROCESSORS_ONLN);
+    NThreads = (NCPU > 0) ? NCPU : 1;
+  }
+  Pool.NThreads = NThreads;
+  pthread_barrier_init(&Pool.Start, NULL, NThreads);
+  pthread_barrier_init(&Pool.Done, NULL, NThreads);
+  Pool.Workers = malloc((NThreads - 1) * sizeof(pthread_t));
+  for (unsigned I = 0; I + 1 < NThreads; ++I)
+    pthread_create(&Pool.Workers[I], NULL, workerMain, NULL);
+}
+
+void stepParallel(word_t *Prev, word_t *Next, unsigned Generations) {
+  if (!Pool.NThreads)
+    setThreadCount(0);
+  Pool.Job.Prev = Prev;
+  Pool.Job.Next = Next;
+  Pool.Job.Generations = Generations ? Generations : 1;
+  atomic_store(&Pool.NextBand, 0);
+  pthread_barrier_wait(&Pool.Start);
+  runBands();
+  pthread_barrier_wait(&Pool.Done);
+}
@@ -0,0 +1,79 @@
+#include "GameOfLife.h"
+#include <stdlib.h>
+#include <string.h>
+
+// A tile is one word wide and TILE_ROWS rows high.
+#define TILE_ROWS 16
+
+static struct {
+  unsigned char *Changed;
+  unsigned char *Active;
+  unsigned X;
+  unsigned Y;
+  int IsValid;
+} Tiles;
+
+static unsigned char *getChanged(unsigned TX, unsigned TY) {
+  return &Tiles.Changed[TY * Tiles.X + TX];
+}
+
+static unsigned char *getActive(unsigned TX, unsigned TY) {
+  return &Tiles.Active[TY * Tiles.X + TX];
+}
+
+static word_t *getRow(word_t *Field, y_t Y) { return &Field[Y * SimWordsX]; }
+
+static y_t getUp(y_t Y) { return (Y ? Y : SimY) - 1; }
+
+static y_t getDown(y_t Y) { return (Y + 1) % SimY; }
+
+static void markActive(unsigned TX, unsigned TY) {
+  for (unsigned DY = Tiles.Y - 1; DY <= Tiles.Y + 1; ++DY)
+    for (unsigned DX = Tiles.X - 1; DX <= Tiles.X + 1; ++DX)
+      *getActive((TX + DX) % Tiles.X, (TY + DY) % Tiles.Y) = 1;
+}
+
+static int stepTile(word_t *Prev, word_t *Next, unsigned TX, unsigned TY) {
+  y_t YEnd = (TY + 1) * TILE_ROWS < SimY ? (TY + 1) * TILE_ROWS : SimY;
+  word_t Diff = 0;
+  for (y_t Y = TY * TILE_ROWS; Y < YEnd; ++Y) {
+    word_t Res = stepPackedWord(getRow(Prev, getUp(Y)), getRow(Prev, Y),
+                                getRow(Prev, getDown(Y)), TX);
+    Diff |= Res ^ getRow(Prev, Y)[TX];
+    getRow(Next, Y)[TX] = Res;
+  }
+  return Diff != 0;
+}
+
+void resetSparse() { Tiles.IsValid = 0; }
+
+void stepSparse(word_t *Prev, word_t *Next) {
+  const unsigned TilesY = (SimY + TILE_ROWS - 1) / TILE_ROWS;
+  if (Tiles.X != SimWordsX || Tiles.Y != TilesY) {
+    free(Tiles.Changed);
+    free(Tiles.Active);
+    Tiles.X = SimWordsX;
+    Tiles.Y = TilesY;
+    Tiles.Changed = malloc(Tiles.X * Tiles.Y);
+    Tiles.Active = malloc(Tiles.X * Tiles.Y);
+    Tiles.IsValid = 0;
+  }
+
+  if (Tiles.IsValid) {
+    memset(Tiles.Active, 0, Tiles.X * Tiles.Y);
+    for (unsigned TY = 0; TY < Tiles.Y; ++TY)
+      for (unsigned TX = 0; TX < Tiles.X; ++TX)
+        if (*getChanged(TX, TY))
+          markActive(TX, TY);
+  } else {
+    memset(Tiles.Active, 1, Tiles.X * Tiles.Y);
+    Tiles.IsValid = 1;
+  }
+
+  // A quiescent tile is equal in Prev and in the generation before it, which
+  // is what Next still holds, so it can be left untouched.
+  for (unsigned TY = 0; TY < Tiles.Y; ++TY)
+    for (unsigned TX = 0; TX < Tiles.X; ++TX)
+      *getChanged(TX, TY) =
+          *getActive(TX, TY) && stepTile(Prev, Next, TX, TY);
+}
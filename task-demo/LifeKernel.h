@@ -0,0 +1,38 @@
+#pragma once
+
+#define RULE_TERM(N, EQ)                                                       \
+  do {                                                                         \
+    if ((Birth >> (N)) & 1)                                                    \
+      Born |= (EQ);                                                            \
+    if ((Survive >> (N)) & 1)                                                  \
+      Kept |= (EQ);                                                            \
+  } while (0)
+
+// Next state of every cell in C given its eight neighbour planes under an
+// outer-totalistic rule (see rule_t). Neighbours are summed with bit-sliced
+// full adders into the count bits S0..S3. Once inlined with constant Birth
+// and Survive, the terms for counts outside of the rule fold away. Includers
+// #undef DEFINE_RULE_KERNEL and RULE_TERM once they have defined their kernels.
+#define DEFINE_RULE_KERNEL(NAME, T)                                            \
+  static inline __attribute__((always_inline)) T NAME(                         \
+      T NW, T N, T NE, T W, T C, T E, T SW, T S, T SE, unsigned Birth,         \
+      unsigned Survive) {                                                      \
+    T U0 = NW ^ N ^ NE, U1 = (NW & N) | (NE & (NW ^ N));                       \
+    T D0 = SW ^ S ^ SE, D1 = (SW & S) | (SE & (SW ^ S));                       \
+    T M0 = W ^ E, M1 = W & E;                                                  \
+    T S0 = U0 ^ M0 ^ D0, L1 = (U0 & M0) | (D0 & (U0 ^ M0));                    \
+    T T0 = U1 ^ M1 ^ D1, T1 = (U1 & M1) | (D1 & (U1 ^ M1));                    \
+    T S1 = T0 ^ L1, H1 = T0 & L1;                                              \
+    T S2 = T1 ^ H1, S3 = T1 & H1;                                              \
+    T Born = C ^ C, Kept = C ^ C;                                              \
+    RULE_TERM(0, ~S3 & ~S2 & ~S1 & ~S0);                                       \
+    RULE_TERM(1, ~S3 & ~S2 & ~S1 & S0);                                        \
+    RULE_TERM(2, ~S3 & ~S2 & S1 & ~S0);                                        \
+    RULE_TERM(3, ~S3 & ~S2 & S1 & S0);                                         \
+    RULE_TERM(4, ~S3 & S2 & ~S1 & ~S0);                                        \
+    RULE_TERM(5, ~S3 & S2 & ~S1 & S0);                                         \
+    RULE_TERM(6, ~S3 & S2 & S1 & ~S0);                                         \
+    RULE_TERM(7, ~S3 & S2 & S1 & S0);                                          \
+    RULE_TERM(8, S3);                                                          \
+    return (Born & ~C) | (Kept & C);                                           \
+  }
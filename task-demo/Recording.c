@@ -0,0 +1,388 @@
+#include "Recording.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#define REC_ALIGN 8
+
+struct RecRun {
+  uint32_t ZeroWords;
+  uint32_t LiteralWords;
+};
+
+struct RecWriter {
+  FILE *File;
+  unsigned KeyInterval;
+  size_t NWords;
+  unsigned long Generation;
+  int Error;
+  // Slots [Tail, Tail + Count) are queued for the writer thread.
+  word_t **Slots;
+  unsigned QueueLen;
+  unsigned Tail;
+  unsigned Count;
+  unsigned long Stalls;
+  int IsClosing;
+  pthread_mutex_t Lock;
+  pthread_cond_t NotEmpty;
+  pthread_cond_t NotFull;
+  pthread_t Thread;
+  word_t *Prev;
+  unsigned char *Runs;
+  unsigned char *Masks;
+};
+
+struct RecReader {
+  unsigned char *Data;
+  size_t Size;
+  struct RecFileHeader *Header;
+  size_t NWords;
+  size_t *Offsets; // Of each generation's record.
+  unsigned long NGenerations;
+  word_t *Cur;
+  unsigned long CurGen;
+  int HasCur;
+};
+
+static size_t getMaxPayload(size_t NWords) {
+  return (NWords + 1) * (sizeof(word_t) + sizeof(struct RecRun));
+}
+
+static size_t getPadding(size_t Size) { return -Size % REC_ALIGN; }
+
+// Encodes Src ^ Base, or Src alone if Base is NULL.
+static size_t encodeWords(word_t *Src, word_t *Base, size_t NWords,
+                          unsigned char *Dst) {
+  unsigned char *Begin = Dst;
+  for (size_t I = 0; I < NWords;) {
+    struct RecRun Run = {0, 0};
+    while (I < NWords && !(Src[I] ^ (Base ? Base[I] : 0)) &&
+           Run.ZeroWords < UINT32_MAX)
+      ++I, ++Run.ZeroWords;
+    word_t *Literals = (word_t *)(Dst + sizeof(Run));
+    while (I < NWords && (Src[I] ^ (Base ? Base[I] : 0)) &&
+           Run.LiteralWords < UINT32_MAX)
+      Literals[Run.LiteralWords++] = Src[I] ^ (Base ? Base[I] : 0), ++I;
+    memcpy(Dst, &Run, sizeof(Run));
+    Dst += sizeof(Run) + Run.LiteralWords * sizeof(word_t);
+  }
+  return Dst - Begin;
+}
+
+// Bit B is set if byte B of W is not zero.
+static unsigned getByteMask(word_t W) {
+  const word_t Low7 = 0x7F7F7F7F7F7F7F7FULL;
+  word_t High = (((W & Low7) + Low7) | W) & ~Low7;
+  return (High >> 7) * 0x0102040810204080ULL >> 56;
+}
+
+// Encodes Src ^ Base, or Src alone if Base is NULL, as a byte mask per word
+// followed by the bytes it marks, and counts the non-zero words. Dst needs 8
+// bytes of slack past the end.
+static size_t encodeMasks(word_t *Src, word_t *Base, size_t NWords,
+                          unsigned char *Dst, size_t *NLiterals) {
+  unsigned char *Begin = Dst;
+  *NLiterals = 0;
+  for (size_t I = 0; I < NWords; ++I) {
+    word_t W = Src[I] ^ (Base ? Base[I] : 0);
+    unsigned Mask = getByteMask(W);
+    *NLiterals += Mask != 0;
+    *Dst++ = Mask;
+#ifdef __BMI2__
+    word_t Bytes = _pext_u64(W, _pdep_u64(Mask, 0x0101010101010101ULL) * 0xFF);
+    memcpy(Dst, &Bytes, sizeof(Bytes));
+    Dst += __builtin_popcount(Mask);
+#else
+    for (unsigned B = 0; B < 8; ++B) {
+      *Dst = W >> (8 * B);
+      Dst += (Mask >> B) & 1;
+    }
+#endif
+  }
+  return Dst - Begin;
+}
+
+// XORs the encoded words into Dst.
+static int decodeMasks(const unsigned char *Src, size_t Size, word_t *Dst,
+                       size_t NWords) {
+  const unsigned char *End = Src + Size;
+  for (size_t I = 0; I < NWords; ++I) {
+    if (Src == End)
+      return -1;
+    unsigned Mask = *Src++;
+    if ((size_t)(End - Src) < (size_t)__builtin_popcount(Mask))
+      return -1;
+    for (unsigned B = 0; B < 8; ++B)
+      if ((Mask >> B) & 1)
+        Dst[I] ^= (word_t)*Src++ << (8 * B);
+  }
+  return Src == End ? 0 : -1;
+}
+
+// XORs the encoded words into Dst.
+static int decodeWords(const unsigned char *Src, size_t Size, word_t *Dst,
+                       size_t NWords) {
+  const unsigned char *End = Src + Size;
+  size_t I = 0;
+  while (Src < End) {
+    struct RecRun Run;
+    if ((size_t)(End - Src) < sizeof(Run))
+      return -1;
+    memcpy(&Run, Src, sizeof(Run));
+    Src += sizeof(Run);
+    I += Run.ZeroWords;
+    if (I + Run.LiteralWords > NWords ||
+        (size_t)(End - Src) < Run.LiteralWords * sizeof(word_t))
+      return -1;
+    const word_t *Literals = (const word_t *)Src;
+    for (uint32_t L = 0; L < Run.LiteralWords; ++L)
+      Dst[I++] ^= Literals[L];
+    Src += Run.LiteralWords * sizeof(word_t);
+  }
+  return 0;
+}
+
+static void writeRecord(struct RecWriter *Writer, word_t *Field) {
+  static const unsigned char Padding[REC_ALIGN];
+  int IsKey = !(Writer->Generation % Writer->KeyInterval);
+  word_t *Base = IsKey ? NULL : Writer->Prev;
+  struct RecHeader Header = {IsKey ? REC_KEY : REC_DELTA, REC_BYTE_MASKS,
+                             Writer->Generation, 0};
+  // Runs take at least a word per non-zero word, so on dense fields they are
+  // not worth encoding.
+  size_t NLiterals;
+  unsigned char *Payload = Writer->Masks;
+  Header.Size = encodeMasks(Field, Base, Writer->NWords, Payload, &NLiterals);
+  if ((NLiterals + 1) * sizeof(word_t) < Header.Size) {
+    size_t RunsSize = encodeWords(Field, Base, Writer->NWords, Writer->Runs);
+    if (RunsSize < Header.Size) {
+      Header.Coding = REC_WORD_RUNS;
+      Header.Size = RunsSize;
+      Payload = Writer->Runs;
+    }
+  }
+  size_t PaddingSize = getPadding(Header.Size);
+  if (fwrite(&Header, sizeof(Header), 1, Writer->File) != 1 ||
+      fwrite(Payload, 1, Header.Size, Writer->File) != Header.Size ||
+      fwrite(Padding, 1, PaddingSize, Writer->File) != PaddingSize)
+    Writer->Error = 1;
+  ++Writer->Generation;
+}
+
+static void *runWriter(void *Arg) {
+  struct RecWriter *Writer = Arg;
+  pthread_mutex_lock(&Writer->Lock);
+  for (;;) {
+    while (!Writer->Count && !Writer->IsClosing)
+      pthread_cond_wait(&Writer->NotEmpty, &Writer->Lock);
+    if (!Writer->Count)
+      break;
+    word_t *Field = Writer->Slots[Writer->Tail];
+    pthread_mutex_unlock(&Writer->Lock);
+    writeRecord(Writer, Field);
+    pthread_mutex_lock(&Writer->Lock);
+    // The written field becomes the base of the next delta, the old base
+    // takes its slot.
+    Writer->Slots[Writer->Tail] = Writer->Prev;
+    Writer->Prev = Field;
+    Writer->Tail = (Writer->Tail + 1) % Writer->QueueLen;
+    --Writer->Count;
+    pthread_cond_signal(&Writer->NotFull);
+  }
+  pthread_mutex_unlock(&Writer->Lock);
+  return NULL;
+}
+
+struct RecWriter *recOpenWriter(const char *Path, unsigned KeyInterval,
+                                unsigned QueueLen) {
+  FILE *File = fopen(Path, "wb");
+  if (!File)
+    return NULL;
+  struct RecFileHeader Header = {REC_MAGIC, SimX, SimY,
+                                 KeyInterval ? KeyInterval : 1, SimRule.Birth,
+                                 SimRule.Survive};
+  if (fwrite(&Header, sizeof(Header), 1, File) != 1) {
+    fclose(File);
+    return NULL;
+  }
+
+  struct RecWriter *Writer = calloc(1, sizeof(*Writer));
+  Writer->File = File;
+  Writer->KeyInterval = Header.KeyInterval;
+  Writer->NWords = (size_t)SimWordsX * SimY;
+  Writer->QueueLen = QueueLen ? QueueLen : 1;
+  Writer->Slots = malloc(Writer->QueueLen * sizeof(word_t *));
+  for (unsigned I = 0; I < Writer->QueueLen; ++I)
+    Writer->Slots[I] = allocPacked();
+  Writer->Prev = allocPacked();
+  Writer->Runs = malloc(getMaxPayload(Writer->NWords));
+  Writer->Masks = malloc(getMaxPayload(Writer->NWords));
+  pthread_mutex_init(&Writer->Lock, NULL);
+  pthread_cond_init(&Writer->NotEmpty, NULL);
+  pthread_cond_init(&Writer->NotFull, NULL);
+  pthread_create(&Writer->Thread, NULL, runWriter, Writer);
+  return Writer;
+}
+
+void recWrite(struct RecWriter *Writer, word_t *Field) {
+  pthread_mutex_lock(&Writer->Lock);
+  if (Writer->Count == Writer->QueueLen)
+    ++Writer->Stalls;
+  while (Writer->Count == Writer->QueueLen)
+    pthread_cond_wait(&Writer->NotFull, &Writer->Lock);
+  unsigned Head = (Writer->Tail + Writer->Count) % Writer->QueueLen;
+  pthread_mutex_unlock(&Writer->Lock);
+
+  // The writer thread does not touch slots outside of the queue.
+  memcpy(Writer->Slots[Head], Field, Writer->NWords * sizeof(word_t));
+
+  pthread_mutex_lock(&Writer->Lock);
+  ++Writer->Count;
+  pthread_cond_signal(&Writer->NotEmpty);
+  pthread_mutex_unlock(&Writer->Lock);
+}
+
+unsigned long recGetStalls(struct RecWriter *Writer) {
+  pthread_mutex_lock(&Writer->Lock);
+  unsigned long Stalls = Writer->Stalls;
+  pthread_mutex_unlock(&Writer->Lock);
+  return Stalls;
+}
+
+int recCloseWriter(struct RecWriter *Writer) {
+  pthread_mutex_lock(&Writer->Lock);
+  Writer->IsClosing = 1;
+  pthread_cond_signal(&Writer->NotEmpty);
+  pthread_mutex_unlock(&Writer->Lock);
+  pthread_join(Writer->Thread, NULL);
+
+  int Res = (fclose(Writer->File) || Writer->Error) ? -1 : 0;
+  for (unsigned I = 0; I < Writer->QueueLen; ++I)
+    freeField(Writer->Slots[I]);
+  free(Writer->Slots);
+  freeField(Writer->Prev);
+  free(Writer->Runs);
+  free(Writer->Masks);
+  pthread_mutex_destroy(&Writer->Lock);
+  pthread_cond_destroy(&Writer->NotEmpty);
+  pthread_cond_destroy(&Writer->NotFull);
+  free(Writer);
+  return Res;
+}
+
+static int indexRecords(struct RecReader *Reader) {
+  size_t Capacity = 1024;
+  Reader->Offsets = malloc(Capacity * sizeof(size_t));
+  for (size_t Offset = sizeof(struct RecFileHeader);
+       Offset + sizeof(struct RecHeader) <= Reader->Size;) {
+    struct RecHeader *Header = (struct RecHeader *)(Reader->Data + Offset);
+    size_t Left = Reader->Size - Offset - sizeof(*Header);
+    if (Header->Size > Left || getPadding(Header->Size) > Left - Header->Size)
+      break;
+    if (Header->Generation != Reader->NGenerations ||
+        (Header->Type != REC_KEY && Header->Type != REC_DELTA) ||
+        (Header->Coding != REC_WORD_RUNS &&
+         Header->Coding != REC_BYTE_MASKS) ||
+        (!Header->Generation && Header->Type != REC_KEY))
+      return -1;
+    if (Reader->NGenerations == Capacity) {
+      Capacity *= 2;
+      Reader->Offsets = realloc(Reader->Offsets, Capacity * sizeof(size_t));
+    }
+    Reader->Offsets[Reader->NGenerations++] = Offset;
+    Offset += sizeof(*Header) + Header->Size + getPadding(Header->Size);
+  }
+  return 0;
+}
+
+struct RecReader *recOpenReader(const char *Path) {
+  int Fd = open(Path, O_RDONLY);
+  if (Fd < 0)
+    return NULL;
+  struct stat Stat;
+  void *Data = MAP_FAILED;
+  if (!fstat(Fd, &Stat) &&
+      (size_t)Stat.st_size >= sizeof(struct RecFileHeader))
+    Data = mmap(NULL, Stat.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+  close(Fd);
+  if (Data == MAP_FAILED)
+    return NULL;
+
+  struct RecReader *Reader = calloc(1, sizeof(*Reader));
+  Reader->Data = Data;
+  Reader->Size = Stat.st_size;
+  Reader->Header = Data;
+  Reader->NWords =
+      (size_t)(Reader->Header->Width + 63) / 64 * Reader->Header->Height;
+  if (memcmp(Reader->Header->Magic, REC_MAGIC, sizeof(Reader->Header->Magic)) ||
+      indexRecords(Reader)) {
+    recCloseReader(Reader);
+    return NULL;
+  }
+  Reader->Cur = malloc(Reader->NWords * sizeof(word_t));
+  return Reader;
+}
+
+x_t recGetWidth(struct RecReader *Reader) { return Reader->Header->Width; }
+
+y_t recGetHeight(struct RecReader *Reader) { return Reader->Header->Height; }
+
+rule_t recGetRule(struct RecReader *Reader) {
+  rule_t Rule = {Reader->Header->Birth, Reader->Header->Survive};
+  return Rule;
+}
+
+unsigned long recGetGenerations(struct RecReader *Reader) {
+  return Reader->NGenerations;
+}
+
+static struct RecHeader *getRecord(struct RecReader *Reader,
+                                   unsigned long Gen) {
+  return (struct RecHeader *)(Reader->Data + Reader->Offsets[Gen]);
+}
+
+int recRead(struct RecReader *Reader, unsigned long Gen, word_t *Field) {
+  if (Gen >= Reader->NGenerations)
+    return -1;
+  unsigned long Key = Gen;
+  while (getRecord(Reader, Key)->Type != REC_KEY)
+    --Key;
+
+  unsigned long From = Key;
+  if (Reader->HasCur && Reader->CurGen <= Gen && Reader->CurGen >= Key) {
+    From = Reader->CurGen + 1;
+  } else {
+    memset(Reader->Cur, 0, Reader->NWords * sizeof(word_t));
+    Reader->HasCur = 0;
+  }
+  for (unsigned long G = From; G <= Gen; ++G) {
+    struct RecHeader *Header = getRecord(Reader, G);
+    unsigned char *Payload = (unsigned char *)(Header + 1);
+    if ((Header->Coding == REC_BYTE_MASKS
+             ? decodeMasks(Payload, Header->Size, Reader->Cur, Reader->NWords)
+             : decodeWords(Payload, Header->Size, Reader->Cur,
+                           Reader->NWords))) {
+      Reader->HasCur = 0;
+      return -1;
+    }
+    Reader->CurGen = G;
+    Reader->HasCur = 1;
+  }
+  memcpy(Field, Reader->Cur, Reader->NWords * sizeof(word_t));
+  return 0;
+}
+
+void recCloseReader(struct RecReader *Reader) {
+  munmap(Reader->Data, Reader->Size);
+  free(Reader->Offsets);
+  free(Reader->Cur);
+  free(Reader);
+}
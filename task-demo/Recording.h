@@ -0,0 +1,72 @@
+#pragma once
+#include "GameOfLife.h"
+
+// Recordings of packed fields, one generation after another. Every
+// KeyInterval-th generation is a keyframe holding the whole field, the
+// others hold the XOR with the generation before. Each record is stored in
+// whichever of two codings is smaller: runs of zero words and literal words,
+// which suit sparse boards and small changes, or a mask of the non-zero bytes
+// of every word followed by those bytes, which suits the scattered changes
+// of a dense board.
+//
+// File layout, native byte order, every record padded to 8 bytes so that a
+// memory-mapped file can be decoded in place:
+//   struct RecFileHeader
+//   { struct RecHeader, payload of Size bytes, padding }...
+// REC_WORD_RUNS payload:
+//   { uint32_t ZeroWords; uint32_t LiteralWords; word_t[LiteralWords] }...
+// REC_BYTE_MASKS payload, one entry per word, bit B of Mask standing for
+// byte B of the word, starting from the least significant:
+//   { uint8_t Mask; uint8_t NonZeroBytes[popcount(Mask)] }...
+
+// The last byte is the format version. Version 2 added the rule, version 3
+// the byte mask coding.
+#define REC_MAGIC "GOLREC\0\3"
+
+enum rec_type_t { REC_KEY = 1, REC_DELTA = 2 };
+enum rec_coding_t { REC_WORD_RUNS = 0, REC_BYTE_MASKS = 1 };
+
+struct RecFileHeader {
+  char Magic[8];
+  uint32_t Width;
+  uint32_t Height;
+  uint32_t KeyInterval;
+  uint16_t Birth;
+  uint16_t Survive;
+};
+
+struct RecHeader {
+  uint32_t Type;
+  uint32_t Coding;
+  uint64_t Generation;
+  uint64_t Size;
+};
+
+struct RecWriter;
+struct RecReader;
+
+#define REC_DEFAULT_QUEUE_LEN 4
+
+// The recording stores the board size and rule current at recOpenWriter.
+// Encoding and disk writes happen on a separate thread. recWrite only copies
+// the field, unless the writer is QueueLen fields behind: then it waits for a
+// free slot, stalling the caller. Each slot takes a packed field of memory.
+struct RecWriter *recOpenWriter(const char *Path, unsigned KeyInterval,
+                                unsigned QueueLen);
+void recWrite(struct RecWriter *Writer, word_t *Field);
+// Number of recWrite calls that had to wait for the writer.
+unsigned long recGetStalls(struct RecWriter *Writer);
+// Returns 0 if everything has been written successfully.
+int recCloseWriter(struct RecWriter *Writer);
+
+// Returns NULL if the file cannot be mapped or is not a recording. A
+// truncated last record, e.g. of a run that crashed, is ignored.
+struct RecReader *recOpenReader(const char *Path);
+x_t recGetWidth(struct RecReader *Reader);
+y_t recGetHeight(struct RecReader *Reader);
+rule_t recGetRule(struct RecReader *Reader);
+unsigned long recGetGenerations(struct RecReader *Reader);
+// Decodes generation Gen into Field, starting from the closest keyframe or
+// from the generation read before if that is closer. Returns 0 on success.
+int recRead(struct RecReader *Reader, unsigned long Gen, word_t *Field);
+void recCloseReader(struct RecReader *Reader);
@@ -0,0 +1,204 @@
+#include "GameOfLife.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_SEED 0x2545F4914F6CDD1DULL
+#define BENCH_MIN_TIME 0.5
+#define SCALING_GENERATIONS 64
+
+static double getTime() {
+  struct timespec T;
+  clock_gettime(CLOCK_MONOTONIC, &T);
+  return T.tv_sec + T.tv_nsec * 1e-9;
+}
+
+static size_t getPackedWords() { return (size_t)SimWordsX * SimY; }
+
+static void seedPacked(word_t *Field) {
+  word_t State = BENCH_SEED;
+  for (size_t I = 0; I < getPackedWords(); ++I) {
+    State ^= State << 13;
+    State ^= State >> 7;
+    State ^= State << 17;
+    Field[I] = State;
+  }
+  if (SimX % 64)
+    for (y_t Y = 0; Y < SimY; ++Y)
+      Field[Y * SimWordsX + SimWordsX - 1] &= ((word_t)1 << (SimX % 64)) - 1;
+}
+
+static unsigned long countAlive(word_t *Field) {
+  unsigned long Res = 0;
+  for (size_t I = 0; I < getPackedWords(); ++I)
+    Res += __builtin_popcountll(Field[I]);
+  return Res;
+}
+
+// Every engine advances packed fields by the returned number of generations.
+// The reference engine converts to and from cells outside of the timed loop.
+static cell_t *Cells[2];
+
+static unsigned stepReference(word_t *Prev, word_t *Next) {
+  (void)Prev;
+  (void)Next;
+  step(Cells[0], Cells[1]);
+  cell_t *Tmp = Cells[0];
+  Cells[0] = Cells[1];
+  Cells[1] = Tmp;
+  return 1;
+}
+
+static unsigned stepPackedEngine(word_t *Prev, word_t *Next) {
+  stepPacked(Prev, Next);
+  return 1;
+}
+
+static unsigned stepParallelEngine(word_t *Prev, word_t *Next) {
+  stepParallel(Prev, Next, 1);
+  return 1;
+}
+
+static unsigned stepSparseEngine(word_t *Prev, word_t *Next) {
+  stepSparse(Prev, Next);
+  return 1;
+}
+
+static unsigned stepHashLifeEngine(word_t *Prev, word_t *Next) {
+  stepHashLife(Prev, Next, 4);
+  return 16;
+}
+
+static const struct {
+  const char *Name;
+  unsigned (*Step)(word_t *Prev, word_t *Next);
+} Engines[] = {{"reference", stepReference},  {"packed", stepPackedEngine},
+               {"parallel", stepParallelEngine}, {"sparse", stepSparseEngine},
+               {"hashlife", stepHashLifeEngine}};
+
+static void benchEngines() {
+  const x_t X = SimX;
+  const y_t Y = SimY;
+  word_t *Seed = allocPacked();
+  word_t *Fields[2] = {allocPacked(), allocPacked()};
+  Cells[0] = allocField();
+  Cells[1] = allocField();
+  seedPacked(Seed);
+
+  for (unsigned E = 0; E < sizeof(Engines) / sizeof(Engines[0]); ++E) {
+    memcpy(Fields[0], Seed, getPackedWords() * sizeof(word_t));
+    unpackField(Seed, Cells[0]);
+    resetSparse();
+    unsigned long Gens = 0;
+    unsigned Cur = 0;
+    double Begin = getTime(), Time;
+    do {
+      Gens += Engines[E].Step(Fields[Cur], Fields[Cur ^ 1]);
+      Cur ^= 1;
+    } while ((Time = getTime() - Begin) < BENCH_MIN_TIME);
+    if (Engines[E].Step == stepReference)
+      packField(Cells[0], Fields[Cur]);
+    printf("%6u %6u %-10s %8lu %12.1f %14.3e %12lu\n", X, Y, Engines[E].Name,
+           Gens, Gens / Time, Gens / Time * X * Y, countAlive(Fields[Cur]));
+  }
+
+  freeField(Seed);
+  freeField(Fields[0]);
+  freeField(Fields[1]);
+  freeField(Cells[0]);
+  freeField(Cells[1]);
+}
+
+static double benchThreads(word_t *Seed, word_t *Fields[2], unsigned NThreads,
+                           unsigned Fused, double Base) {
+  setThreadCount(NThreads);
+  memcpy(Fields[0], Seed, getPackedWords() * sizeof(word_t));
+  double Begin = getTime();
+  unsigned Cur = 0;
+  for (unsigned Gen = 0; Gen < SCALING_GENERATIONS; Gen += Fused, Cur ^= 1)
+    stepParallel(Fields[Cur], Fields[Cur ^ 1], Fused);
+  double Time = getTime() - Begin;
+  double GensPerSec = SCALING_GENERATIONS / Time;
+  printf("%8u %6u %12.1f %14.3e %8.2fx %12lu\n", NThreads, Fused, GensPerSec,
+         GensPerSec * SimX * SimY, Base ? Base / Time : 1.0,
+         countAlive(Fields[Cur]));
+  return Time;
+}
+
+// Doubles the thread count, but always ends on every CPU.
+static long getNextThreadCount(long NThreads, long NCPU) {
+  return (NThreads < NCPU && 2 * NThreads > NCPU) ? NCPU : 2 * NThreads;
+}
+
+static void benchScaling() {
+  const x_t X = SimX;
+  const y_t Y = SimY;
+  word_t *Seed = allocPacked();
+  word_t *Fields[2] = {allocPacked(), allocPacked()};
+  seedPacked(Seed);
+
+  long NCPU = sysconf(_SC_NPROCESSORS_ONLN);
+  printf("%ux%u board, %d generations, %ld CPUs\n", X, Y, SCALING_GENERATIONS,
+         NCPU);
+  printf("%8s %6s %12s %14s %9s %12s\n", "threads", "fused", "gen/s",
+         "cells/s", "speedup", "alive");
+  double Base = benchThreads(Seed, Fields, 1, 1, 0);
+  for (unsigned Fused = 1; Fused <= 4; Fused *= 4)
+    for (long NThreads = 1; NThreads <= NCPU;
+         NThreads = getNextThreadCount(NThreads, NCPU))
+      if (NThreads > 1 || Fused > 1)
+        benchThreads(Seed, Fields, NThreads, Fused, Base);
+
+  freeField(Seed);
+  freeField(Fields[0]);
+  freeField(Fields[1]);
+}
+
+static int reportSize(const char *X, const char *Y) {
+  fprintf(stderr, "Error: invalid board size %s %s\n", X, Y);
+  return 1;
+}
+
+// bench [--rule R] [W H]...          engines on each board size
+// bench [--rule R] --scaling W H     stepParallel over thread counts
+int main(int argc, char **argv) {
+  if (argc > 2 && !strcmp(argv[1], "--rule")) {
+    rule_t Rule;
+    if (parseRule(argv[2], &Rule)) {
+      fprintf(stderr, "Error: invalid rule %s\n", argv[2]);
+      return 1;
+    }
+    setRule(Rule);
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc == 4 && !strcmp(argv[1], "--scaling")) {
+    if (parseBoardSize(argv[2], argv[3]))
+      return reportSize(argv[2], argv[3]);
+    benchScaling();
+    return 0;
+  }
+  if (argc % 2 == 0) {
+    fprintf(stderr, "Error: expected pairs of width and height\n");
+    return 1;
+  }
+  for (int I = 1; I + 1 < argc; I += 2)
+    if (parseBoardSize(argv[I], argv[I + 1]))
+      return reportSize(argv[I], argv[I + 1]);
+
+  printf("%6s %6s %-10s %8s %12s %14s %12s\n", "width", "height", "engine",
+         "gens", "gen/s", "cells/s", "alive");
+  if (argc > 2) {
+    for (int I = 1; I + 1 < argc; I += 2) {
+      parseBoardSize(argv[I], argv[I + 1]);
+      benchEngines();
+    }
+    return 0;
+  }
+  for (unsigned Size = 256; Size <= 4096; Size *= 4) {
+    setBoardSize(Size, Size);
+    benchEngines();
+  }
+}
@@ -0,0 +1,266 @@
+#include "GameOfLife.h"
+#include "Recording.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CHECK_GENERATIONS 32
+#define FUSED_GENERATIONS 5
+#define REC_GENERATIONS 40
+#define REC_KEY_INTERVAL 8
+
+// Odd, word-boundary and power-of-two sizes.
+static const unsigned Sizes[][2] = {
+    {4, 3},    {10, 10},  {8, 8},     {16, 16},   {63, 7},    {64, 64},
+    {65, 5},   {128, 128}, {130, 20}, {256, 100}, {300, 200}, {700, 300}};
+
+static const size_t HashCacheLimits[] = {(size_t)64 << 20, 64 << 10, 0};
+
+// The specialized kernels plus rules that run through the generic one.
+static const char *Rules[] = {"Life",       "HighLife", "DayAndNight",
+                              "Seeds",      "Replicator", "B36/S125",
+                              "B0/S8",      "B012345678/S012345678"};
+
+static size_t getPackedBytes() {
+  return (size_t)SimWordsX * SimY * sizeof(word_t);
+}
+
+static int isSame(word_t *A, word_t *B) {
+  return !memcmp(A, B, getPackedBytes());
+}
+
+static int report(const char *Rule, const char *Engine, unsigned Gen) {
+  fprintf(stderr, "Error: %s differs from step for %s on %ux%u at gen %u\n",
+          Engine, Rule, SimX, SimY, Gen);
+  return 1;
+}
+
+// Runs every engine next to step and compares the boards after each
+// generation, or after each jump for HashLife.
+static int checkSize(const char *Rule, x_t X, y_t Y) {
+  setBoardSize(X, Y);
+  cell_t *Cells[2] = {allocField(), allocField()};
+  word_t *Ref = allocPacked();
+  word_t *Packed[2] = {allocPacked(), allocPacked()};
+  word_t *Parallel[2] = {allocPacked(), allocPacked()};
+  word_t *Sparse[2] = {allocPacked(), allocPacked()};
+  word_t *Hash[2] = {allocPacked(), allocPacked()};
+  unsigned Seed = rand();
+  srand(Seed);
+  seedGen(Cells[0]);
+  packField(Cells[0], Packed[0]);
+  srand(Seed);
+  seedGenPacked(Ref);
+  memcpy(Parallel[0], Packed[0], getPackedBytes());
+  memcpy(Sparse[0], Packed[0], getPackedBytes());
+  memcpy(Hash[0], Packed[0], getPackedBytes());
+  resetSparse();
+
+  int Failed = isSame(Ref, Packed[0]) ? 0 : report(Rule, "seedGenPacked", 0);
+  unsigned Cur = 0, HashGen = 0;
+  for (unsigned Gen = 1; Gen <= CHECK_GENERATIONS && !Failed;
+       ++Gen, Cur ^= 1) {
+    step(Cells[Cur], Cells[Cur ^ 1]);
+    packField(Cells[Cur ^ 1], Ref);
+    stepPacked(Packed[Cur], Packed[Cur ^ 1]);
+    setThreadCount(1 + Gen % 3);
+    stepParallel(Parallel[Cur], Parallel[Cur ^ 1], 1);
+    stepSparse(Sparse[Cur], Sparse[Cur ^ 1]);
+    if (!isSame(Ref, Packed[Cur ^ 1]))
+      Failed = report(Rule, "stepPacked", Gen);
+    else if (!isSame(Ref, Parallel[Cur ^ 1]))
+      Failed = report(Rule, "stepParallel", Gen);
+    else if (!isSame(Ref, Sparse[Cur ^ 1]))
+      Failed = report(Rule, "stepSparse", Gen);
+
+    // Jumps of 1, 2, 4, ... generations land on 1, 3, 7, ...
+    if (!Failed && Gen == 2 * HashGen + 1) {
+      unsigned Log2Gens = 0;
+      while ((1u << Log2Gens) < Gen - HashGen)
+        ++Log2Gens;
+      stepHashLife(Hash[0], Hash[1], Log2Gens);
+      memcpy(Hash[0], Hash[1], getPackedBytes());
+      HashGen = Gen;
+      if (!isSame(Ref, Hash[0]))
+        Failed = report(Rule, "stepHashLife", Gen);
+    }
+  }
+
+  if (!Failed) {
+    memcpy(Parallel[0], Packed[Cur], getPackedBytes());
+    stepParallel(Parallel[0], Parallel[1], FUSED_GENERATIONS);
+    for (unsigned Gen = 0; Gen < FUSED_GENERATIONS; ++Gen, Cur ^= 1)
+      stepPacked(Packed[Cur], Packed[Cur ^ 1]);
+    if (!isSame(Packed[Cur], Parallel[1]))
+      Failed = report(Rule, "fused stepParallel",
+                      CHECK_GENERATIONS + FUSED_GENERATIONS);
+  }
+
+  freeField(Cells[0]);
+  freeField(Cells[1]);
+  freeField(Ref);
+  for (unsigned I = 0; I < 2; ++I) {
+    freeField(Packed[I]);
+    freeField(Parallel[I]);
+    freeField(Sparse[I]);
+    freeField(Hash[I]);
+  }
+  return Failed;
+}
+
+// A quiet board leaves no tile marked as changed, a resize that keeps the
+// tile grid must still make stepSparse recompute the whole field.
+static int checkResize() {
+  setBoardSize(100, 100);
+  word_t *Quiet[2] = {allocPacked(), allocPacked()};
+  memset(Quiet[0], 0, getPackedBytes());
+  resetSparse();
+  stepSparse(Quiet[0], Quiet[1]);
+  stepSparse(Quiet[1], Quiet[0]);
+  freeField(Quiet[0]);
+  freeField(Quiet[1]);
+
+  setBoardSize(120, 100);
+  cell_t *Cells = allocField();
+  word_t *Packed[2] = {allocPacked(), allocPacked()};
+  word_t *Sparse[2] = {allocPacked(), allocPacked()};
+  seedGen(Cells);
+  packField(Cells, Packed[0]);
+  memcpy(Sparse[0], Packed[0], getPackedBytes());
+  memset(Sparse[1], 0xFF, getPackedBytes());
+
+  int Failed = 0;
+  unsigned Cur = 0;
+  for (unsigned Gen = 1; Gen <= CHECK_GENERATIONS && !Failed;
+       ++Gen, Cur ^= 1) {
+    stepPacked(Packed[Cur], Packed[Cur ^ 1]);
+    stepSparse(Sparse[Cur], Sparse[Cur ^ 1]);
+    if (!isSame(Packed[Cur ^ 1], Sparse[Cur ^ 1]))
+      Failed = report("Life", "stepSparse after a resize", Gen);
+  }
+
+  freeField(Cells);
+  for (unsigned I = 0; I < 2; ++I) {
+    freeField(Packed[I]);
+    freeField(Sparse[I]);
+  }
+  return Failed;
+}
+
+static int reportRec(const char *What, unsigned long Gen) {
+  fprintf(stderr, "Error: recording %s at gen %lu\n", What, Gen);
+  return 1;
+}
+
+// Reads Gen and compares it with the generation that was written.
+static int checkRecRead(struct RecReader *Reader, word_t **Gens,
+                        unsigned long Gen, word_t *Field) {
+  if (recRead(Reader, Gen, Field))
+    return reportRec("cannot be read", Gen);
+  if (!isSame(Gens[Gen], Field))
+    return reportRec("differs from what was written", Gen);
+  return 0;
+}
+
+// Writes a run and reads it back out of order, across keyframes and
+// repeatedly, then once more with the last record cut short.
+static int checkRecording() {
+  setBoardSize(70, 20);
+  setRule((rule_t){0x048, 0x00C});
+  word_t *Gens[REC_GENERATIONS];
+  cell_t *Cells = allocField();
+  Gens[0] = allocPacked();
+  seedGen(Cells);
+  packField(Cells, Gens[0]);
+  freeField(Cells);
+  for (unsigned Gen = 1; Gen < REC_GENERATIONS; ++Gen) {
+    Gens[Gen] = allocPacked();
+    stepPacked(Gens[Gen - 1], Gens[Gen]);
+    // Keep only the top row of the later generations so that their
+    // records are mostly zero words and take the word run coding.
+    if (Gen >= REC_GENERATIONS / 2)
+      memset(Gens[Gen] + SimWordsX, 0,
+             getPackedBytes() - SimWordsX * sizeof(word_t));
+  }
+
+  char Path[] = "/tmp/check-rec-XXXXXX";
+  int Fd = mkstemp(Path);
+  if (Fd < 0) {
+    perror("Error: mkstemp");
+    return 1;
+  }
+  close(Fd);
+  struct RecWriter *Writer = recOpenWriter(Path, REC_KEY_INTERVAL, 1);
+  for (unsigned Gen = 0; Gen < REC_GENERATIONS; ++Gen)
+    recWrite(Writer, Gens[Gen]);
+  int Failed = recCloseWriter(Writer) ? reportRec("cannot be written", 0) : 0;
+
+  static const unsigned long Order[] = {30, 5, 17, 17, 18, 7, 8, 39, 0, 39};
+  word_t *Field = allocPacked();
+  struct RecReader *Reader = NULL;
+  if (!Failed && !(Reader = recOpenReader(Path)))
+    Failed = reportRec("cannot be opened", 0);
+  if (!Failed) {
+    rule_t Rule = recGetRule(Reader);
+    if (recGetWidth(Reader) != SimX || recGetHeight(Reader) != SimY ||
+        Rule.Birth != SimRule.Birth || Rule.Survive != SimRule.Survive ||
+        recGetGenerations(Reader) != REC_GENERATIONS)
+      Failed = reportRec("has a wrong header", 0);
+    for (unsigned I = 0; I < sizeof(Order) / sizeof(*Order) && !Failed; ++I)
+      Failed = checkRecRead(Reader, Gens, Order[I], Field);
+    if (!Failed && !recRead(Reader, REC_GENERATIONS, Field))
+      Failed = reportRec("reads past its end", REC_GENERATIONS);
+  }
+  if (Reader)
+    recCloseReader(Reader);
+
+  // The truncated last record is dropped, the ones before stay readable.
+  struct stat Stat;
+  Reader = NULL;
+  if (!Failed && (stat(Path, &Stat) || truncate(Path, Stat.st_size - 1) ||
+                  !(Reader = recOpenReader(Path))))
+    Failed = reportRec("cannot be opened after truncation", 0);
+  if (!Failed) {
+    if (recGetGenerations(Reader) != REC_GENERATIONS - 1)
+      Failed = reportRec("keeps a truncated record", REC_GENERATIONS - 1);
+    else if (!recRead(Reader, REC_GENERATIONS - 1, Field))
+      Failed = reportRec("reads a truncated record", REC_GENERATIONS - 1);
+    else
+      Failed = checkRecRead(Reader, Gens, REC_GENERATIONS - 2, Field) ||
+               checkRecRead(Reader, Gens, 3, Field);
+  }
+  if (Reader)
+    recCloseReader(Reader);
+
+  unlink(Path);
+  freeField(Field);
+  for (unsigned Gen = 0; Gen < REC_GENERATIONS; ++Gen)
+    freeField(Gens[Gen]);
+  return Failed;
+}
+
+int main() {
+  int Failed = 0;
+  for (unsigned R = 0; R < sizeof(Rules) / sizeof(*Rules); ++R) {
+    rule_t Rule;
+    if (parseRule(Rules[R], &Rule)) {
+      fprintf(stderr, "Error: invalid rule %s\n", Rules[R]);
+      return 1;
+    }
+    setRule(Rule);
+    for (unsigned S = 0; S < sizeof(Sizes) / sizeof(*Sizes); ++S) {
+      // A limit of 64 KiB abandons and splits jumps on the bigger boards, one
+      // of 0 steps every generation without the cache.
+      setHashLifeCacheLimit(HashCacheLimits[S % 3]);
+      Failed |= checkSize(Rules[R], Sizes[S][0], Sizes[S][1]);
+    }
+  }
+  setRule((rule_t){0x008, 0x00C});
+  Failed |= checkResize();
+  Failed |= checkRecording();
+  if (!Failed)
+    printf("All engines match step, recordings read back\n");
+  return Failed;
+}
@@ -1,12 +1,226 @@
 #include "GameOfLife.h"
+#include "Recording.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-int main() {
-  cell_t Fields[SIM_X * SIM_Y][2];
-  seedGen(Fields[0]);
+#define DEFAULT_KEY_INTERVAL 64
+#define MAX_THREADS 1024
+#define MAX_QUEUE_LEN 1024
+
+// Recording the run starts from, if any, and the one it is written to.
+static struct RecReader *Checkpoint;
+static unsigned long CheckpointGen;
+static struct RecWriter *Recorder;
+
+static void initField(word_t *Packed) {
+  if (Checkpoint) {
+    if (recRead(Checkpoint, CheckpointGen, Packed)) {
+      fprintf(stderr, "Error: no generation %lu in the recording\n",
+              CheckpointGen);
+      exit(1);
+    }
+    return;
+  }
+  seedGenPacked(Packed);
+}
+
+static void record(word_t *Packed) {
+  if (Recorder)
+    recWrite(Recorder, Packed);
+}
+
+static int isSameFile(const char *A, const char *B) {
+  struct stat StatA, StatB;
+  return !stat(A, &StatA) && !stat(B, &StatB) &&
+         StatA.st_dev == StatB.st_dev && StatA.st_ino == StatB.st_ino;
+}
+
+// The packed engine publishes frames to the backend's render thread, the
+// reference engine draws every generation itself.
+#ifndef SIM_REFERENCE
+static void run(word_t *Init) {
+  word_t *Packed[2] = {Init, allocPacked()};
+  record(Packed[0]);
+  initFrames();
+  while (simIsRunning()) {
+    stepParallel(Packed[0], Packed[1], 1);
+    record(Packed[1]);
+    publishFrame(Packed[1]);
+    stepParallel(Packed[1], Packed[0], 1);
+    record(Packed[0]);
+    publishFrame(Packed[0]);
+  }
+  freeField(Packed[0]);
+  freeField(Packed[1]);
+}
+#else
+static void recordCells(cell_t *Field, word_t *Packed) {
+  if (!Recorder)
+    return;
+  packField(Field, Packed);
+  record(Packed);
+}
+
+static void run(word_t *Init) {
+  cell_t *Fields[2] = {allocField(), allocField()};
+  word_t *Packed = Init;
+  unpackField(Packed, Fields[0]);
+  record(Packed);
   while (simIsRunning()) {
     step(Fields[0], Fields[1]);
+    recordCells(Fields[1], Packed);
     fillImgBuffer(Fields[0]);
     step(Fields[1], Fields[0]);
+    recordCells(Fields[0], Packed);
     fillImgBuffer(Fields[1]);
   }
+  freeField(Fields[0]);
+  freeField(Fields[1]);
+  freeField(Packed);
+}
+#endif
+
+static void printUsage(const char *Name) {
+  fprintf(stderr,
+          "Usage: %s [-R rule] [-t threads] "
+          "[-r recording [-k key interval] [-q queue length]] "
+          "[-l recording [-g generation]] [width height]\n",
+          Name);
+}
+
+int main(int argc, char **argv) {
+  const char *RecordPath = NULL;
+  const char *LoadPath = NULL;
+  unsigned long KeyInterval = DEFAULT_KEY_INTERVAL;
+  unsigned long QueueLen = REC_DEFAULT_QUEUE_LEN;
+  unsigned long NThreads;
+  int HasCheckpointGen = 0;
+  const char *RuleName = NULL;
+  rule_t Rule;
+  int Opt;
+  while ((Opt = getopt(argc, argv, "R:t:r:k:q:l:g:")) != -1) {
+    switch (Opt) {
+    case 'R':
+      if (parseRule(optarg, &Rule)) {
+        fprintf(stderr, "Error: invalid rule %s\n", optarg);
+        return 1;
+      }
+      RuleName = optarg;
+      setRule(Rule);
+      break;
+    case 't':
+      if (parseUnsigned(optarg, MAX_THREADS, &NThreads)) {
+        fprintf(stderr, "Error: invalid thread count %s, it has to be at "
+                        "most %d, 0 uses every CPU\n",
+                optarg, MAX_THREADS);
+        return 1;
+      }
+      setThreadCount(NThreads);
+      break;
+    case 'r':
+      RecordPath = optarg;
+      break;
+    case 'k':
+      if (parseUnsigned(optarg, UINT_MAX, &KeyInterval) || !KeyInterval) {
+        fprintf(stderr, "Error: invalid key interval %s, it has to be at "
+                        "least 1\n",
+                optarg);
+        return 1;
+      }
+      break;
+    case 'q':
+      if (parseUnsigned(optarg, MAX_QUEUE_LEN, &QueueLen) || !QueueLen) {
+        fprintf(stderr, "Error: invalid queue length %s, it has to be from 1 "
+                        "to %d\n",
+                optarg, MAX_QUEUE_LEN);
+        return 1;
+      }
+      break;
+    case 'l':
+      LoadPath = optarg;
+      if (!(Checkpoint = recOpenReader(optarg))) {
+        fprintf(stderr, "Error: cannot read recording %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'g':
+      if (parseUnsigned(optarg, ULONG_MAX, &CheckpointGen)) {
+        fprintf(stderr, "Error: invalid generation %s\n", optarg);
+        return 1;
+      }
+      HasCheckpointGen = 1;
+      break;
+    default:
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind != argc && optind + 2 != argc) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (Checkpoint) {
+    if (optind != argc) {
+      fprintf(stderr, "Error: the board size is taken from the recording\n");
+      printUsage(argv[0]);
+      return 1;
+    }
+    if (setBoardSize(recGetWidth(Checkpoint), recGetHeight(Checkpoint))) {
+      fprintf(stderr, "Error: invalid board size in the recording\n");
+      return 1;
+    }
+    rule_t Recorded = recGetRule(Checkpoint);
+    if (RuleName && (Rule.Birth != Recorded.Birth ||
+                     Rule.Survive != Recorded.Survive)) {
+      fprintf(stderr, "Error: rule %s differs from the rule of the recording\n",
+              RuleName);
+      return 1;
+    }
+    setRule(Recorded);
+    if (!recGetGenerations(Checkpoint)) {
+      fprintf(stderr, "Error: recording %s holds no generations\n", LoadPath);
+      return 1;
+    }
+    if (!HasCheckpointGen)
+      CheckpointGen = recGetGenerations(Checkpoint) - 1;
+  } else if (optind + 2 == argc &&
+             parseBoardSize(argv[optind], argv[optind + 1])) {
+    fprintf(stderr, "Error: invalid board size %s %s, the width has to be at "
+                    "least %d and the height at least 1\n",
+            argv[optind], argv[optind + 1], SIM_MIN_X);
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (Checkpoint && RecordPath && isSameFile(LoadPath, RecordPath)) {
+    fprintf(stderr, "Error: cannot record into the recording being loaded\n");
+    return 1;
+  }
+
+  // The checkpoint is decoded and unmapped before the writer creates its file.
+  word_t *Init = allocPacked();
+  initField(Init);
+  if (Checkpoint)
+    recCloseReader(Checkpoint);
+  if (RecordPath &&
+      !(Recorder = recOpenWriter(RecordPath, KeyInterval, QueueLen))) {
+    fprintf(stderr, "Error: cannot write recording %s\n", RecordPath);
+    return 1;
+  }
+
+  run(Init);
+
+  // The writer only stalls the simulation if it cannot keep up, say so.
+  if (Recorder && recGetStalls(Recorder))
+    fprintf(stderr,
+            "Warning: the simulation waited for the recording %lu times, a "
+            "longer -q queue absorbs bursts\n",
+            recGetStalls(Recorder));
+  if (Recorder && recCloseWriter(Recorder)) {
+    fprintf(stderr, "Error: failed to write recording %s\n", RecordPath);
+    return 1;
+  }
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <stdint.h>
+
 #ifndef IMG_X
 #define IMG_X 800
 #endif
@@ -17,3 +19,13 @@ void simSetPixel(int x, int y, struct SIM_Color Color);
 void simFlush();
 int simRand();
 int simIsRunning();
+
+// Frame pipeline: the simulation publishes bit-packed frames (one bit per
+// cell, (Width + 63) / 64 words per row) and the backend draws the latest one
+// on its own thread at display rate. Publishing never blocks, frames the
+// display has no time for are dropped.
+void simInitFrames(unsigned Width, unsigned Height, struct SIM_Color Alive,
+                   struct SIM_Color Dead);
+int simWantsFrame();
+uint64_t *simGetBackFrame();
+void simPublishFrame();
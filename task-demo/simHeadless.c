@@ -0,0 +1,36 @@
+#include "sim.h"
+#include <stdlib.h>
+
+// Number of frames to run for, as there is no window to close.
+#ifndef HEADLESS_FRAMES
+#define HEADLESS_FRAMES 1000
+#endif
+
+static unsigned long Frames;
+static uint64_t *Frame;
+
+void simSetPixel(int X, int Y, struct SIM_Color Color) {
+  (void)X;
+  (void)Y;
+  (void)Color;
+}
+
+void simFlush() { ++Frames; }
+
+int simRand() { return rand(); }
+
+int simIsRunning() { return Frames < HEADLESS_FRAMES; }
+
+void simInitFrames(unsigned Width, unsigned Height, struct SIM_Color Alive,
+                   struct SIM_Color Dead) {
+  (void)Alive;
+  (void)Dead;
+  free(Frame);
+  Frame = malloc((size_t)(Width + 63) / 64 * Height * sizeof(uint64_t));
+}
+
+int simWantsFrame() { return 1; }
+
+uint64_t *simGetBackFrame() { return Frame; }
+
+void simPublishFrame() { ++Frames; }
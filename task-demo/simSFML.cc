@@ -3,11 +3,23 @@ extern "C" {
 }
 #include <SFML/Graphics.hpp>
 #include <SFML/System.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
+#include <thread>
+#include <vector>
+
+#ifndef SIM_FPS
+#define SIM_FPS 60
+#endif
 
 sf::RenderWindow Window{sf::VideoMode(IMG_X, IMG_Y), "SFML"};
-sf::Image Field;
+sf::Texture Texture;
+sf::Sprite Sprite;
 sf::Uint8 Pixels[IMG_X * IMG_Y * 4];
 
 void simSetPixel(int X, int Y, struct SIM_Color Color) {
@@ -19,24 +31,225 @@ void simSetPixel(int X, int Y, struct SIM_Color Color) {
 }
 
 void simFlush() {
-  Field.create(IMG_X, IMG_Y, Pixels);
-  sf::Texture Texture;
-  Texture.loadFromImage(Field);
-  sf::Sprite Sprite;
-  Sprite.setTexture(Texture, true);
+  if (!Texture.getSize().x) {
+    Texture.create(IMG_X, IMG_Y);
+    Sprite.setTexture(Texture, true);
+    Window.setFramerateLimit(SIM_FPS);
+  }
+  Texture.update(Pixels);
   Window.clear();
   Window.draw(Sprite);
   Window.display();
-  sf::sleep(sf::seconds(1));
 }
 
 int simRand() { return std::rand(); }
 
+namespace {
+using PixelT = std::uint32_t;
+static_assert(sizeof(SIM_Color) == sizeof(PixelT));
+
+// Triple buffer of packed frames. The simulation fills Back and swaps it
+// with Middle on publishing, the renderer swaps Front with Middle whenever
+// the latter holds a frame it has not seen yet.
+struct FrameQueue {
+  static constexpr unsigned Fresh = 4;
+  std::array<std::vector<std::uint64_t>, 3> Buffers;
+  unsigned Back = 0;
+  unsigned Front = 1;
+  std::atomic<unsigned> Middle{2};
+  unsigned Width = 0;
+  unsigned Height = 0;
+  unsigned WordsX = 0;
+  std::atomic<bool> IsRendering{false};
+  std::thread Renderer;
+} Frames;
+
+// Pixels of each combination of 8 cells, so that cells are expanded a byte
+// at a time.
+std::array<std::array<PixelT, 8>, 256> ByteToPixels;
+
+PixelT toPixel(SIM_Color Color) {
+  PixelT Res;
+  std::memcpy(&Res, &Color, sizeof(Res));
+  return Res;
+}
+
+void expandRow(const std::uint64_t *Row, PixelT *Dst, unsigned Width) {
+  unsigned X = 0;
+  for (; X + 8 <= Width; X += 8) {
+    auto Byte = (Row[X / 64] >> (X % 64)) & 0xFF;
+    std::memcpy(Dst + X, ByteToPixels[Byte].data(), 8 * sizeof(PixelT));
+  }
+  for (; X < Width; ++X)
+    Dst[X] = ByteToPixels[(Row[X / 64] >> (X % 64)) & 1][0];
+}
+
+// Whether any of the cells [X0, X1) of a packed row is alive.
+bool isAnyAlive(const std::uint64_t *Row, unsigned X0, unsigned X1) {
+  for (auto X = X0; X < X1;) {
+    auto Bits = std::min(64 - X % 64, X1 - X);
+    auto Mask = Bits == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << Bits) - 1;
+    if ((Row[X / 64] >> (X % 64)) & Mask)
+      return true;
+    X += Bits;
+  }
+  return false;
+}
+
+// First of the Cells cells that fall into pixel P of Pixels <= Cells.
+unsigned getFirstCell(unsigned P, unsigned Pixels, unsigned Cells) {
+  return static_cast<std::uint64_t>(P) * Cells / Pixels;
+}
+
+// Shows frames at no more than the window resolution, a pixel is alive if
+// any of the cells that fall into it is. Only the bands of pixel rows that
+// differ from the frame shown before are uploaded.
+class FrameTexture {
+  sf::Texture Texture;
+  sf::Sprite Sprite;
+  unsigned Width;
+  unsigned Height;
+  unsigned WordsX;
+  // Reduced frames, one bit per pixel and WordsX words per row.
+  std::vector<std::uint64_t> Shown;
+  std::vector<std::uint64_t> Next;
+  // Board rows of one pixel row OR-ed together.
+  std::vector<std::uint64_t> Cells;
+  std::vector<PixelT> Band;
+
+  void reduce(const std::vector<std::uint64_t> &Frame) {
+    for (unsigned Y = 0; Y < Height; ++Y) {
+      auto CY = getFirstCell(Y, Height, Frames.Height);
+      auto CY1 = getFirstCell(Y + 1, Height, Frames.Height);
+      std::copy_n(&Frame[static_cast<std::size_t>(CY) * Frames.WordsX],
+                  Frames.WordsX, Cells.begin());
+      for (++CY; CY < CY1; ++CY) {
+        auto *Row = &Frame[static_cast<std::size_t>(CY) * Frames.WordsX];
+        for (unsigned W = 0; W < Frames.WordsX; ++W)
+          Cells[W] |= Row[W];
+      }
+
+      auto *Dst = &Next[Y * WordsX];
+      if (Width == Frames.Width) {
+        std::copy_n(Cells.begin(), WordsX, Dst);
+        continue;
+      }
+      std::fill_n(Dst, WordsX, 0);
+      for (unsigned X = 0; X < Width; ++X)
+        if (isAnyAlive(Cells.data(), getFirstCell(X, Width, Frames.Width),
+                       getFirstCell(X + 1, Width, Frames.Width)))
+          Dst[X / 64] |= std::uint64_t{1} << (X % 64);
+    }
+  }
+
+  bool isRowShown(unsigned Y) const {
+    auto Begin = Y * WordsX;
+    return std::equal(Next.begin() + Begin, Next.begin() + Begin + WordsX,
+                      Shown.begin() + Begin);
+  }
+
+  void uploadRows(const std::vector<std::uint64_t> &Frame, unsigned Y0,
+                  unsigned Y1) {
+    for (auto Y = Y0; Y < Y1; ++Y)
+      expandRow(&Frame[Y * WordsX], &Band[(Y - Y0) * Width], Width);
+    Texture.update(reinterpret_cast<const sf::Uint8 *>(Band.data()), Width,
+                   Y1 - Y0, 0, Y0);
+  }
+
+public:
+  FrameTexture()
+      : Width(std::min(Frames.Width, static_cast<unsigned>(IMG_X))),
+        Height(std::min(Frames.Height, static_cast<unsigned>(IMG_Y))),
+        WordsX((Width + 63) / 64), Shown(WordsX * Height),
+        Next(WordsX * Height), Cells(Frames.WordsX), Band(Width * Height) {
+    Texture.create(Width, Height);
+    uploadRows(Shown, 0, Height);
+    Sprite.setTexture(Texture, true);
+    Sprite.setScale(static_cast<float>(IMG_X) / Width,
+                    static_cast<float>(IMG_Y) / Height);
+  }
+
+  void update(const std::vector<std::uint64_t> &Frame) {
+    reduce(Frame);
+    for (unsigned Y = 0; Y < Height;) {
+      if (isRowShown(Y)) {
+        ++Y;
+        continue;
+      }
+      auto Y1 = Y + 1;
+      while (Y1 < Height && !isRowShown(Y1))
+        ++Y1;
+      uploadRows(Next, Y, Y1);
+      Y = Y1;
+    }
+    std::swap(Shown, Next);
+  }
+
+  const sf::Sprite &getSprite() const { return Sprite; }
+};
+
+void renderFrames() {
+  Window.setActive(true);
+  FrameTexture Output;
+  while (Frames.IsRendering) {
+    if (Frames.Middle.load(std::memory_order_acquire) & FrameQueue::Fresh) {
+      Frames.Front = Frames.Middle.exchange(Frames.Front,
+                                            std::memory_order_acq_rel) &
+                     ~FrameQueue::Fresh;
+      Output.update(Frames.Buffers[Frames.Front]);
+    }
+    Window.clear();
+    Window.draw(Output.getSprite());
+    Window.display();
+  }
+  Window.setActive(false);
+}
+
+void stopRenderer() {
+  if (!Frames.Renderer.joinable())
+    return;
+  Frames.IsRendering = false;
+  Frames.Renderer.join();
+}
+} // namespace
+
+void simInitFrames(unsigned Width, unsigned Height, struct SIM_Color Alive,
+                   struct SIM_Color Dead) {
+  stopRenderer();
+  Frames.Width = Width;
+  Frames.Height = Height;
+  Frames.WordsX = (Width + 63) / 64;
+  for (auto &Buffer : Frames.Buffers)
+    Buffer.assign(static_cast<std::size_t>(Frames.WordsX) * Height, 0);
+  for (unsigned Byte = 0; Byte < ByteToPixels.size(); ++Byte)
+    for (unsigned Bit = 0; Bit < 8; ++Bit)
+      ByteToPixels[Byte][Bit] = toPixel((Byte >> Bit) & 1 ? Alive : Dead);
+
+  Window.setFramerateLimit(SIM_FPS);
+  Window.setActive(false);
+  Frames.IsRendering = true;
+  Frames.Renderer = std::thread(renderFrames);
+}
+
+int simWantsFrame() {
+  return !(Frames.Middle.load(std::memory_order_acquire) & FrameQueue::Fresh);
+}
+
+uint64_t *simGetBackFrame() { return Frames.Buffers[Frames.Back].data(); }
+
+void simPublishFrame() {
+  Frames.Back = Frames.Middle.exchange(Frames.Back | FrameQueue::Fresh,
+                                       std::memory_order_acq_rel) &
+                ~FrameQueue::Fresh;
+}
+
 int simIsRunning() {
   sf::Event Event;
   while (Window.pollEvent(Event)) {
-    if (Event.type == sf::Event::Closed)
+    if (Event.type == sf::Event::Closed) {
+      stopRenderer();
       Window.close();
+    }
   }
   return Window.isOpen();
 }
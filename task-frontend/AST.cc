@@ -189,4 +189,106 @@ Value *ExprPrint::genIR(LLVMContext &Context, Module &Module,
   std::vector<Value *> ArgsV{Arg->genIR(Context, Module, Builder, NamedValues)};
   return Builder.CreateCall(Callee, ArgsV, "calltmp");
 }
+
+void Empty::dump(std::ostream &OS) const { OS << "(Empty " << Loc << ")"; }
+
+void ASTModule::dump(std::ostream &OS) const {
+  OS << "(Module";
+  for (auto *F : Funcs) {
+    OS << " ";
+    F->dump(OS);
+  }
+  OS << ")";
+}
+
+void Scope::dump(std::ostream &OS) const {
+  OS << "(Scope " << Loc;
+  for (auto *Block : Blocks) {
+    OS << " ";
+    Block->dump(OS);
+  }
+  OS << ")";
+}
+
+void While::dump(std::ostream &OS) const {
+  OS << "(While " << Loc << " ";
+  Condition->dump(OS);
+  OS << " ";
+  Body->dump(OS);
+  OS << ")";
+}
+
+void If::dump(std::ostream &OS) const {
+  OS << "(If " << Loc << " ";
+  Condition->dump(OS);
+  OS << " ";
+  Then->dump(OS);
+  if (Else) {
+    OS << " ";
+    Else->dump(OS);
+  }
+  OS << ")";
+}
+
+void ExprAssign::dump(std::ostream &OS) const {
+  OS << "(Assign " << Loc << " ";
+  Id->dump(OS);
+  OS << " ";
+  Value->dump(OS);
+  OS << ")";
+}
+
+void ExprInt::dump(std::ostream &OS) const {
+  OS << "(Int " << Loc << " " << Value.getSExtValue() << ")";
+}
+
+void ExprId::dump(std::ostream &OS) const {
+  OS << "(Id " << Loc << " " << Name << ")";
+}
+
+void Let::dump(std::ostream &OS) const {
+  OS << "(Let " << Loc << " ";
+  Id->dump(OS);
+  OS << " ";
+  Value->dump(OS);
+  OS << ")";
+}
+
+void Return::dump(std::ostream &OS) const {
+  OS << "(Return " << Loc << " ";
+  Value->dump(OS);
+  OS << ")";
+}
+
+void ExprFunc::dump(std::ostream &OS) const {
+  OS << "(Func " << Loc << " ";
+  Id->dump(OS);
+  OS << " (";
+  for (auto *D : ArgDecls) {
+    if (D != ArgDecls.front())
+      OS << " ";
+    D->dump(OS);
+  }
+  OS << ") ";
+  Body->dump(OS);
+  OS << ")";
+}
+
+void ExprApply::dump(std::ostream &OS) const {
+  OS << "(Apply " << Loc << " ";
+  Id->dump(OS);
+  for (auto *A : Args) {
+    OS << " ";
+    A->dump(OS);
+  }
+  OS << ")";
+}
+
+void ExprQmark::dump(std::ostream &OS) const { OS << "(Qmark " << Loc << ")"; }
+
+void ExprPrint::dump(std::ostream &OS) const {
+  OS << "(Print " << Loc << " ";
+  Arg->dump(OS);
+  OS << ")";
+}
 } // namespace AST
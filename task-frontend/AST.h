@@ -45,6 +45,9 @@ struct Expr : public INode {
   virtual llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                              llvm::IRBuilder<> &Builder,
                              ValsT &NamedValues) const = 0;
+  // Prints the tree with locations as an s-expression, so that the trees
+  // built by different parsers can be compared.
+  virtual void dump(std::ostream &OS) const = 0;
 };
 
 struct Empty : public Expr {
@@ -52,6 +55,7 @@ struct Empty : public Expr {
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprFunc;
@@ -72,6 +76,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct While : public Expr {
@@ -86,6 +91,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct If : public Expr {
@@ -101,6 +107,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct Return : public Expr {
@@ -112,6 +119,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprInt : public Expr {
@@ -123,6 +131,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprId : public Expr {
@@ -131,6 +140,7 @@ struct ExprId : public Expr {
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprQmark : public Expr {
@@ -139,6 +149,7 @@ struct ExprQmark : public Expr {
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 struct ExprPrint : public Expr {
 private:
@@ -149,6 +160,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 struct Let : public Expr {
 private:
@@ -161,6 +173,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprFunc : public Expr {
@@ -189,6 +202,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprApply : public Expr {
@@ -212,6 +226,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ExprAssign : public Expr {
@@ -225,6 +240,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 struct ASTModule : public Expr {
@@ -243,6 +259,7 @@ public:
   llvm::Value *genIR(llvm::LLVMContext &Context, llvm::Module &Module,
                      llvm::IRBuilder<> &Builder,
                      ValsT &NamedValues) const override;
+  void dump(std::ostream &OS) const override;
 };
 
 template <typename OpTy> struct ExprBinOp : public Expr {
@@ -259,6 +276,13 @@ public:
     auto *R = RHS->genIR(Context, Module, Builder, NamedValues);
     return OpTy::genIR(Builder, L, R);
   }
+  void dump(std::ostream &OS) const override {
+    OS << "(" << OpTy::Name << " " << Loc << " ";
+    LHS->dump(OS);
+    OS << " ";
+    RHS->dump(OS);
+    OS << ")";
+  }
 };
 
 template <typename OpTy> struct ExprUnOp : public Expr {
@@ -273,81 +297,99 @@ public:
     auto *R = RHS->genIR(Context, Module, Builder, NamedValues);
     return OpTy::genIR(Builder, R);
   }
+  void dump(std::ostream &OS) const override {
+    OS << "(" << OpTy::Name << " " << Loc << " ";
+    RHS->dump(OS);
+    OS << ")";
+  }
 };
 
 struct BinOpMul {
+  static constexpr const char *Name = "*";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateMul(LHS, RHS);
   }
 };
 struct BinOpDiv {
+  static constexpr const char *Name = "/";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateSDiv(LHS, RHS);
   }
 };
 struct BinOpMod {
+  static constexpr const char *Name = "%";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateSRem(LHS, RHS);
   }
 };
 struct BinOpPlus {
+  static constexpr const char *Name = "+";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateAdd(LHS, RHS);
   }
 };
 struct BinOpMinus {
+  static constexpr const char *Name = "-";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateSub(LHS, RHS);
   }
 };
 struct BinOpLess {
+  static constexpr const char *Name = "<";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpSLT(LHS, RHS);
   }
 };
 struct BinOpGrtr {
+  static constexpr const char *Name = ">";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpSGT(LHS, RHS);
   }
 };
 struct BinOpLessOrEq {
+  static constexpr const char *Name = "<=";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpSLE(LHS, RHS);
   }
 };
 struct BinOpGrtrOrEq {
+  static constexpr const char *Name = ">=";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpSGE(LHS, RHS);
   }
 };
 struct BinOpEqual {
+  static constexpr const char *Name = "==";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpEQ(LHS, RHS);
   }
 };
 struct BinOpNotEqual {
+  static constexpr const char *Name = "!=";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateICmpNE(LHS, RHS);
   }
 };
 struct BinOpAnd {
+  static constexpr const char *Name = "&&";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateAnd(LHS, RHS);
   }
 };
 struct BinOpOr {
+  static constexpr const char *Name = "||";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder, llvm::Value *LHS,
                                    llvm::Value *RHS) {
     return Builder.CreateOr(LHS, RHS);
@@ -355,18 +397,21 @@ struct BinOpOr {
 };
 
 struct UnOpPlus {
+  static constexpr const char *Name = "u+";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder,
                                    llvm::Value *RHS) {
     return RHS;
   }
 };
 struct UnOpMinus {
+  static constexpr const char *Name = "u-";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder,
                                    llvm::Value *RHS) {
     return Builder.CreateNeg(RHS);
   }
 };
 struct UnOpNot {
+  static constexpr const char *Name = "!";
   static inline llvm::Value *genIR(llvm::IRBuilder<> &Builder,
                                    llvm::Value *RHS) {
     return Builder.CreateNot(RHS);
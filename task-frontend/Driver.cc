@@ -1,22 +1,111 @@
 #include "Driver.h"
+#include <chrono>
 #include <fstream>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Format.h>
+#include <sstream>
 
 using namespace llvm;
+enum class ParserKind { Bison, RD };
+
 cl::opt<std::string> OutputFilename("o", cl::desc("<output file>"),
-                                    cl::Required);
+                                    cl::init("-"));
 cl::opt<std::string> InputFilename(cl::Positional, cl::desc("<input file>"),
                                    cl::Required);
+cl::opt<ParserKind> ParserChoice(
+    "parser", cl::desc("Parser to use"),
+    cl::values(clEnumValN(ParserKind::Bison, "bison",
+                          "bison-generated parser (reference)"),
+               clEnumValN(ParserKind::RD, "rd",
+                          "hand-written recursive-descent parser")),
+    cl::init(ParserKind::Bison));
+cl::opt<bool> CompareParsers(
+    "compare-parsers",
+    cl::desc("Parse with both parsers, fail if their ASTs differ"));
+cl::opt<bool> TimeParse(
+    "time-parse",
+    cl::desc("Time parsing only with both parsers, lexing and AST included"));
+cl::opt<double> TimeParseSeconds(
+    "time-parse-seconds",
+    cl::desc("Minimum time to repeat each parser for with -time-parse"),
+    cl::init(0.5));
+
+static std::string dumpAST(const AST::ASTModule *Root) {
+  std::ostringstream OS;
+  if (Root)
+    Root->dump(OS);
+  return OS.str();
+}
+
+// Placeholders built by error recovery may differ between the parsers, so
+// on invalid input both only have to report an error.
+static int compareParsers() {
+  std::ifstream BisonInput{InputFilename}, RDInput{InputFilename};
+  yy::Driver BisonDriver{&BisonInput}, RDDriver{&RDInput};
+  std::unique_ptr<AST::ASTModule> BisonRoot{BisonDriver.parse()};
+  std::unique_ptr<AST::ASTModule> RDRoot{RDDriver.parseRD()};
+  bool BisonFailed = BisonDriver.nerrs || !BisonRoot;
+  bool RDFailed = RDDriver.nerrs || !RDRoot;
+  std::string BisonAST = dumpAST(BisonRoot.get());
+  std::string RDAST = dumpAST(RDRoot.get());
+  if (BisonFailed == RDFailed && (BisonFailed || BisonAST == RDAST))
+    return 0;
+  errs() << "Error: parsers disagree on " << InputFilename << "\nbison: "
+         << (BisonFailed ? "syntax error" : BisonAST) << "\nrd:    "
+         << (RDFailed ? "syntax error" : RDAST) << "\n";
+  return 1;
+}
+
+// Seconds per parse of Source, repeated for at least TimeParseSeconds. The
+// input is read into memory first, so no file access is timed.
+static double timeParser(const std::string &Source, ParserKind Kind) {
+  using Clock = std::chrono::steady_clock;
+  unsigned long Runs = 0;
+  Clock::duration Elapsed{};
+  const std::chrono::duration<double> MinTime{TimeParseSeconds};
+  do {
+    std::istringstream Input{Source};
+    auto Start = Clock::now();
+    yy::Driver Driver{&Input};
+    std::unique_ptr<AST::ASTModule> Root{
+        Kind == ParserKind::RD ? Driver.parseRD() : Driver.parse()};
+    Elapsed += Clock::now() - Start;
+    ++Runs;
+  } while (Elapsed < MinTime);
+  return std::chrono::duration<double>(Elapsed).count() / Runs;
+}
+
+static int timeParsers() {
+  std::ifstream File{InputFilename};
+  if (!File) {
+    errs() << "Error: cannot read " << InputFilename << "\n";
+    return 1;
+  }
+  std::ostringstream Source;
+  Source << File.rdbuf();
+  double BisonTime = timeParser(Source.str(), ParserKind::Bison);
+  double RDTime = timeParser(Source.str(), ParserKind::RD);
+  outs() << "bison: " << format("%.3f", BisonTime * 1e3) << " ms/parse\n"
+         << "rd:    " << format("%.3f", RDTime * 1e3) << " ms/parse, "
+         << format("%.2f", BisonTime / RDTime) << "x bison\n";
+  return 0;
+}
 
 int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv);
+  if (CompareParsers)
+    return compareParsers();
+  if (TimeParse)
+    return timeParsers();
 
   std::ifstream InputFile{InputFilename};
   std::error_code OsErr;
   raw_fd_ostream OutputFile{OutputFilename, OsErr};
 
   yy::Driver Driver{&InputFile};
-  std::unique_ptr<AST::ASTModule> Root{Driver.parse()};
+  std::unique_ptr<AST::ASTModule> Root{ParserChoice == ParserKind::RD
+                                           ? Driver.parseRD()
+                                           : Driver.parse()};
   if (!Root)
     return 0;
 
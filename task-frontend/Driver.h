@@ -2,17 +2,25 @@
 #include "AST.h"
 #include "Grammar.tab.hh"
 #include "Lexer.h"
+#include "Parser.h"
 
 namespace yy {
 struct Driver final {
   Lexer lexer;
   AST::INode *yylval;
-  Driver(std::istream *is) : lexer(is), yylval(nullptr) {}
+  unsigned nerrs;
+  Driver(std::istream *is) : lexer(is), yylval(nullptr), nerrs(0) {}
   AST::ASTModule *parse() {
     yy::parser parser{*this};
     if (parser())
       return nullptr;
     return static_cast<AST::ASTModule *>(yylval);
   }
+  AST::ASTModule *parseRD() {
+    yy::RDParser parser{lexer};
+    auto *Root = parser.parse();
+    nerrs = parser.getNumErrors();
+    return Root;
+  }
 };
 } // namespace yy
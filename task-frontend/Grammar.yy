@@ -137,5 +137,6 @@ exprs : exprs COMA expr { $$ = static_cast<ExprApply *>($1)->addArg($3); }
 %%
 
 void yy::parser::error(const location_type &loc, const std::string &err_message) {
+  ++driver.nerrs;
   std::cerr << "Error: " << err_message << " at " << loc << std::endl;
 }
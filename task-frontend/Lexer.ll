@@ -45,6 +45,7 @@ id	[a-zA-Z_][a-zA-Z_0-9]*
 "?"		return yy::parser::token::TOK_QMARK;
 "print"		return yy::parser::token::TOK_PRINT;
 "while" 	return yy::parser::token::TOK_WHILE;
+"let"		return yy::parser::token::TOK_LET;
 "if"		return yy::parser::token::TOK_IF;
 "else"		return yy::parser::token::TOK_ELSE;
 "func"		return yy::parser::token::TOK_FUNC;
@@ -0,0 +1,498 @@
+#include "Parser.h"
+#include <sstream>
+#include <string>
+
+using namespace AST;
+using token = yy::parser::token;
+
+namespace {
+// Levels of the precedence declarations in Grammar.yy, lowest first.
+enum Precedence : unsigned {
+  PrecOr = 1,
+  PrecAnd,
+  PrecAssign,
+  PrecCompare,
+  PrecAdd,
+  PrecMul,
+};
+
+// Deepest nesting of blocks and unary expressions. Each level takes a few
+// stack frames, deeper input is a syntax error rather than a stack overflow.
+constexpr unsigned MaxNesting = 4096;
+
+template <typename OpTy> INode *makeBinOp(yy::location L, INode *LHS,
+                                          INode *RHS) {
+  return new ExprBinOp<OpTy>(L, LHS, RHS);
+}
+
+struct BinOpInfo {
+  unsigned Prec;
+  INode *(*Make)(yy::location L, INode *LHS, INode *RHS);
+};
+
+BinOpInfo getBinOp(token::yytokentype Tok) {
+  switch (Tok) {
+  case token::TOK_OR:
+    return {PrecOr, makeBinOp<BinOpOr>};
+  case token::TOK_AND:
+    return {PrecAnd, makeBinOp<BinOpAnd>};
+  case token::TOK_EQ:
+    return {PrecCompare, makeBinOp<BinOpEqual>};
+  case token::TOK_NEQ:
+    return {PrecCompare, makeBinOp<BinOpNotEqual>};
+  case token::TOK_LE:
+    return {PrecCompare, makeBinOp<BinOpLessOrEq>};
+  case token::TOK_GE:
+    return {PrecCompare, makeBinOp<BinOpGrtrOrEq>};
+  case token::TOK_LT:
+    return {PrecCompare, makeBinOp<BinOpLess>};
+  case token::TOK_GT:
+    return {PrecCompare, makeBinOp<BinOpGrtr>};
+  case token::TOK_PLUS:
+    return {PrecAdd, makeBinOp<BinOpPlus>};
+  case token::TOK_MINUS:
+    return {PrecAdd, makeBinOp<BinOpMinus>};
+  case token::TOK_STAR:
+    return {PrecMul, makeBinOp<BinOpMul>};
+  case token::TOK_SLASH:
+    return {PrecMul, makeBinOp<BinOpDiv>};
+  case token::TOK_PERCNT:
+    return {PrecMul, makeBinOp<BinOpMod>};
+  default:
+    return {0, nullptr};
+  }
+}
+
+bool startsExpr(token::yytokentype Tok) {
+  switch (Tok) {
+  case token::TOK_LPAR:
+  case token::TOK_NUM:
+  case token::TOK_ID:
+  case token::TOK_QMARK:
+  case token::TOK_PRINT:
+  case token::TOK_PLUS:
+  case token::TOK_MINUS:
+  case token::TOK_EXCL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool startsBlock(token::yytokentype Tok) {
+  switch (Tok) {
+  case token::TOK_LBRACE:
+  case token::TOK_WHILE:
+  case token::TOK_IF:
+  case token::TOK_LET:
+  case token::TOK_RETURN:
+  case token::TOK_SEMICOLON:
+    return true;
+  default:
+    return startsExpr(Tok);
+  }
+}
+
+const char *getTokenName(token::yytokentype Tok) {
+  switch (Tok) {
+  case token::TOK_END:
+    return "end of file";
+  case token::TOK_PLUS:
+    return "'+'";
+  case token::TOK_MINUS:
+    return "'-'";
+  case token::TOK_STAR:
+    return "'*'";
+  case token::TOK_SLASH:
+    return "'/'";
+  case token::TOK_PERCNT:
+    return "'%'";
+  case token::TOK_EQ:
+    return "'=='";
+  case token::TOK_ASSIGN:
+    return "'='";
+  case token::TOK_LET:
+    return "'let'";
+  case token::TOK_EXCL:
+    return "'!'";
+  case token::TOK_NEQ:
+    return "'!='";
+  case token::TOK_LE:
+    return "'<='";
+  case token::TOK_GE:
+    return "'>='";
+  case token::TOK_LT:
+    return "'<'";
+  case token::TOK_GT:
+    return "'>'";
+  case token::TOK_AND:
+    return "'&&'";
+  case token::TOK_OR:
+    return "'||'";
+  case token::TOK_QMARK:
+    return "'?'";
+  case token::TOK_PRINT:
+    return "'print'";
+  case token::TOK_WHILE:
+    return "'while'";
+  case token::TOK_IF:
+    return "'if'";
+  case token::TOK_ELSE:
+    return "'else'";
+  case token::TOK_LBRACE:
+    return "'{'";
+  case token::TOK_RBRACE:
+    return "'}'";
+  case token::TOK_LPAR:
+    return "'('";
+  case token::TOK_RPAR:
+    return "')'";
+  case token::TOK_SEMICOLON:
+    return "';'";
+  case token::TOK_COLON:
+    return "':'";
+  case token::TOK_COMA:
+    return "','";
+  case token::TOK_NUM:
+    return "number";
+  case token::TOK_ID:
+    return "identifier";
+  case token::TOK_FUNC:
+    return "'func'";
+  case token::TOK_RETURN:
+    return "'return'";
+  default:
+    return "invalid token";
+  }
+}
+
+yy::location span(const yy::location &Begin, const yy::location &End) {
+  yy::location Res = Begin;
+  Res.end = End.end;
+  return Res;
+}
+} // namespace
+
+namespace yy {
+class RDParser::NestingGuard final {
+  RDParser &P;
+
+public:
+  explicit NestingGuard(RDParser &Parser) : P(Parser) {
+    if (P.Depth == MaxNesting) {
+      P.report(
+          parser::syntax_error(P.TokLoc, "syntax error, nesting too deep"));
+      throw Abort{};
+    }
+    ++P.Depth;
+  }
+  NestingGuard(const NestingGuard &) = delete;
+  NestingGuard &operator=(const NestingGuard &) = delete;
+  ~NestingGuard() { --P.Depth; }
+};
+
+void RDParser::next() {
+  delete TokVal;
+  TokVal = nullptr;
+  try {
+    Tok = Lex.yylex(&TokVal, &LexLoc);
+  } catch (const parser::syntax_error &Err) {
+    // Always reported, the invalid token then only triggers recovery.
+    report(Err);
+    ErrStatus = 3;
+    Tok = token::TOK_YYUNDEF;
+  }
+  TokLoc = LexLoc;
+}
+
+void RDParser::consume() {
+  if (ErrStatus)
+    --ErrStatus;
+  next();
+}
+
+RDParser::NodeT RDParser::takeValue() {
+  NodeT Res{TokVal};
+  TokVal = nullptr;
+  return Res;
+}
+
+location RDParser::expect(TokenT Kind) {
+  if (Tok != Kind)
+    fail({Kind});
+  location Res = TokLoc;
+  consume();
+  return Res;
+}
+
+void RDParser::fail(std::initializer_list<TokenT> Expected) {
+  std::string Names;
+  for (auto Kind : Expected)
+    Names += (Names.empty() ? "" : " or ") + std::string(getTokenName(Kind));
+  fail(Names.c_str());
+}
+
+void RDParser::fail(const char *Expected) {
+  std::ostringstream Msg;
+  Msg << "syntax error, unexpected " << getTokenName(Tok);
+  if (Tok == token::TOK_ID)
+    Msg << " '" << static_cast<ExprId *>(TokVal)->Name << "'";
+  Msg << ", expecting " << Expected;
+  throw parser::syntax_error(TokLoc, Msg.str());
+}
+
+void RDParser::report(const parser::syntax_error &Err) {
+  ++NErrors;
+  std::cerr << "Error: " << Err.what() << " at " << Err.location << std::endl;
+}
+
+// Skips to a token that can follow a block, as bison does after shifting the
+// error token.
+void RDParser::recover() {
+  while (!startsBlock(Tok) && Tok != token::TOK_RBRACE) {
+    if (Tok == token::TOK_END)
+      throw Abort{};
+    next();
+  }
+  ErrStatus = 3;
+}
+
+AST::ASTModule *RDParser::parse() {
+  try {
+    next();
+    auto Module = std::make_unique<ASTModule>();
+    if (Tok != token::TOK_FUNC)
+      fail({token::TOK_FUNC});
+    while (Tok != token::TOK_END) {
+      if (Tok != token::TOK_FUNC)
+        fail({token::TOK_FUNC, token::TOK_END});
+      Module->addFunction(parseFunc().Node.release());
+    }
+    return Module.release();
+  } catch (const parser::syntax_error &Err) {
+    if (!ErrStatus)
+      report(Err);
+  } catch (const Abort &) {
+  }
+  return nullptr;
+}
+
+RDParser::Parsed RDParser::parseFunc() {
+  location Begin = expect(token::TOK_FUNC);
+  if (Tok != token::TOK_ID)
+    fail({token::TOK_ID});
+  NodeT Id = takeValue();
+  consume();
+
+  auto Func = std::make_unique<ExprFunc>();
+  expect(token::TOK_LPAR);
+  if (Tok != token::TOK_RPAR) {
+    if (Tok != token::TOK_ID)
+      fail({token::TOK_ID, token::TOK_RPAR});
+    for (;;) {
+      Func->addArgDecl(takeValue().release());
+      consume();
+      if (Tok != token::TOK_COMA)
+        break;
+      consume();
+      if (Tok != token::TOK_ID)
+        fail({token::TOK_ID});
+    }
+    if (Tok != token::TOK_RPAR)
+      fail({token::TOK_COMA, token::TOK_RPAR});
+  }
+  consume();
+
+  Parsed Body = parseScope();
+  location Loc = span(Begin, Body.Loc);
+  Func->addBody(Body.Node.release())->addId(Id.release())->addLocation(Loc);
+  return {std::move(Func), Loc};
+}
+
+RDParser::Parsed RDParser::parseScope() {
+  location Begin = expect(token::TOK_LBRACE);
+  auto Res = std::make_unique<Scope>();
+  while (Tok != token::TOK_RBRACE) {
+    if (Tok == token::TOK_END)
+      fail({token::TOK_RBRACE});
+    Res->addBlock(parseBlock().Node.release());
+  }
+  location Loc = span(Begin, TokLoc);
+  consume();
+  Res->addLocation(Loc);
+  return {std::move(Res), Loc};
+}
+
+RDParser::Parsed RDParser::parseBlock() {
+  NestingGuard Guard{*this};
+  location Begin = TokLoc;
+  try {
+    return parseStatement();
+  } catch (const parser::syntax_error &Err) {
+    if (!ErrStatus)
+      report(Err);
+    location Loc = span(Begin, Err.location);
+    recover();
+    return {std::make_unique<Empty>(Loc), Loc};
+  }
+}
+
+RDParser::Parsed RDParser::parseStatement() {
+  location Begin = TokLoc;
+  switch (Tok) {
+  case token::TOK_LBRACE:
+    return parseScope();
+  case token::TOK_SEMICOLON:
+    consume();
+    return {std::make_unique<Empty>(Begin), Begin};
+  case token::TOK_WHILE: {
+    consume();
+    expect(token::TOK_LPAR);
+    Parsed Cond = parseExpr(PrecOr);
+    expect(token::TOK_RPAR);
+    Parsed Body = parseBlock();
+    location Loc = span(Begin, Body.Loc);
+    return {std::make_unique<While>(Loc, Cond.Node.release(),
+                                    Body.Node.release()),
+            Loc};
+  }
+  case token::TOK_IF: {
+    consume();
+    expect(token::TOK_LPAR);
+    Parsed Cond = parseExpr(PrecOr);
+    expect(token::TOK_RPAR);
+    Parsed Then = parseBlock();
+    // A dangling else belongs to the innermost if, as with %right ELSE THEN.
+    if (Tok != token::TOK_ELSE) {
+      location Loc = span(Begin, Then.Loc);
+      return {std::make_unique<If>(Loc, Cond.Node.release(),
+                                   Then.Node.release()),
+              Loc};
+    }
+    consume();
+    Parsed Else = parseBlock();
+    location Loc = span(Begin, Else.Loc);
+    return {std::make_unique<If>(Loc, Cond.Node.release(), Then.Node.release(),
+                                 Else.Node.release()),
+            Loc};
+  }
+  case token::TOK_LET: {
+    consume();
+    if (Tok != token::TOK_ID)
+      fail({token::TOK_ID});
+    NodeT Id = takeValue();
+    consume();
+    Parsed Value = parseExpr(PrecOr);
+    location Loc = span(Begin, expect(token::TOK_SEMICOLON));
+    return {std::make_unique<Let>(Loc, Id.release(), Value.Node.release()),
+            Loc};
+  }
+  case token::TOK_RETURN: {
+    consume();
+    Parsed Value = parseExpr(PrecOr);
+    location Loc = span(Begin, expect(token::TOK_SEMICOLON));
+    return {std::make_unique<Return>(Loc, Value.Node.release()), Loc};
+  }
+  default:
+    if (!startsExpr(Tok))
+      fail("statement");
+    Parsed Res = parseExpr(PrecOr);
+    Res.Loc = span(Res.Loc, expect(token::TOK_SEMICOLON));
+    return Res;
+  }
+}
+
+RDParser::Parsed RDParser::parseExpr(unsigned MinPrec) {
+  Parsed LHS = parseUnary();
+  for (;;) {
+    BinOpInfo Op = getBinOp(Tok);
+    if (!Op.Make || Op.Prec < MinPrec)
+      return LHS;
+    consume();
+    Parsed RHS = parseExpr(Op.Prec + 1);
+    location Loc = span(LHS.Loc, RHS.Loc);
+    LHS.Node.reset(Op.Make(Loc, LHS.Node.release(), RHS.Node.release()));
+    LHS.Loc = Loc;
+  }
+}
+
+RDParser::Parsed RDParser::parseUnary() {
+  NestingGuard Guard{*this};
+  location Begin = TokLoc;
+  switch (Tok) {
+  case token::TOK_LPAR: {
+    consume();
+    Parsed Res = parseExpr(PrecOr);
+    Res.Loc = span(Begin, expect(token::TOK_RPAR));
+    return Res;
+  }
+  case token::TOK_NUM: {
+    NodeT Res = takeValue();
+    consume();
+    return {std::move(Res), Begin};
+  }
+  case token::TOK_QMARK:
+    consume();
+    return {std::make_unique<ExprQmark>(Begin), Begin};
+  case token::TOK_PRINT: {
+    // PRINT binds looser than any operator, so it takes the whole expression.
+    consume();
+    Parsed Arg = parseExpr(PrecOr);
+    location Loc = span(Begin, Arg.Loc);
+    return {std::make_unique<ExprPrint>(Loc, Arg.Node.release()), Loc};
+  }
+  case token::TOK_PLUS:
+  case token::TOK_MINUS:
+  case token::TOK_EXCL: {
+    TokenT Op = Tok;
+    consume();
+    Parsed Arg = parseUnary();
+    location Loc = span(Begin, Arg.Loc);
+    INode *Res;
+    if (Op == token::TOK_PLUS)
+      Res = new ExprUnOp<UnOpPlus>(Loc, Arg.Node.release());
+    else if (Op == token::TOK_MINUS)
+      Res = new ExprUnOp<UnOpMinus>(Loc, Arg.Node.release());
+    else
+      Res = new ExprUnOp<UnOpNot>(Loc, Arg.Node.release());
+    return {NodeT{Res}, Loc};
+  }
+  case token::TOK_ID: {
+    NodeT Id = takeValue();
+    consume();
+    if (Tok == token::TOK_LPAR)
+      return parseApply(std::move(Id), Begin);
+    if (Tok != token::TOK_ASSIGN)
+      return {std::move(Id), Begin};
+    // ASSIGN binds tighter than && and || but looser than the rest.
+    consume();
+    Parsed Value = parseExpr(PrecAssign + 1);
+    location Loc = span(Begin, Value.Loc);
+    return {std::make_unique<ExprAssign>(Loc, Id.release(),
+                                         Value.Node.release()),
+            Loc};
+  }
+  default:
+    fail("expression");
+  }
+}
+
+RDParser::Parsed RDParser::parseApply(NodeT Id, location Begin) {
+  auto Res = std::make_unique<ExprApply>();
+  consume();
+  if (Tok != token::TOK_RPAR) {
+    for (;;) {
+      Res->addArg(parseExpr(PrecOr).Node.release());
+      if (Tok != token::TOK_COMA)
+        break;
+      consume();
+    }
+    if (Tok != token::TOK_RPAR)
+      fail({token::TOK_COMA, token::TOK_RPAR});
+  }
+  location Loc = span(Begin, TokLoc);
+  consume();
+  Res->addId(Id.release())->addLocation(Loc);
+  return {std::move(Res), Loc};
+}
+} // namespace yy
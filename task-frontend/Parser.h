@@ -0,0 +1,65 @@
+#pragma once
+#include "AST.h"
+#include "Grammar.tab.hh"
+#include "Lexer.h"
+#include <initializer_list>
+#include <memory>
+
+namespace yy {
+// Hand-written parser for the grammar in Grammar.yy over the same token
+// stream, building the same AST. Binary operators are parsed by precedence
+// climbing with the levels of the %left/%precedence declarations there.
+// Like the bison parser, syntax errors are recovered from by replacing the
+// innermost enclosing block with an Empty node.
+class RDParser final {
+  using TokenT = parser::token::yytokentype;
+  using NodeT = std::unique_ptr<AST::INode>;
+
+  struct Parsed {
+    NodeT Node;
+    location Loc; // Whole grammar symbol, parentheses included.
+  };
+
+  // Thrown when recovery runs into the end of the input or the input is
+  // nested too deeply.
+  struct Abort {};
+  class NestingGuard;
+
+  Lexer &Lex;
+  location LexLoc;
+  TokenT Tok;
+  AST::INode *TokVal = nullptr;
+  location TokLoc;
+  // Tokens to shift after an error before errors are reported again.
+  unsigned ErrStatus = 0;
+  unsigned NErrors = 0;
+  // Blocks and unary expressions being parsed, every recursion of the parser
+  // goes through one of them.
+  unsigned Depth = 0;
+
+  void next();
+  void consume();
+  NodeT takeValue();
+  location expect(TokenT Kind);
+  [[noreturn]] void fail(std::initializer_list<TokenT> Expected);
+  [[noreturn]] void fail(const char *Expected);
+  void report(const parser::syntax_error &Err);
+  void recover();
+
+  Parsed parseFunc();
+  Parsed parseScope();
+  Parsed parseBlock();
+  Parsed parseStatement();
+  Parsed parseExpr(unsigned MinPrec);
+  Parsed parseUnary();
+  Parsed parseApply(NodeT Id, location Begin);
+
+public:
+  explicit RDParser(Lexer &L) : Lex(L) {}
+  RDParser(const RDParser &) = delete;
+  RDParser &operator=(const RDParser &) = delete;
+  ~RDParser() { delete TokVal; }
+  AST::ASTModule *parse();
+  unsigned getNumErrors() const { return NErrors; }
+};
+} // namespace yy
@@ -0,0 +1,222 @@
+// Writes random programs for checking the parsers against each other with
+// driver.out -compare-parsers:
+//   progen.out <directory> <count>
+// writes valid-N.mylang and mutated-N.mylang for every N < count. Program N
+// is generated from seed N, so the batch is the same on every run. The
+// mutated one has a few tokens deleted, inserted or replaced, which makes
+// most of them syntax errors that the parsers have to agree on. nested.mylang
+// holds an expression in NestedParens parentheses, deeper than the
+// hand-written parser accepts.
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+const char *const Idents[] = {"a", "b", "c", "x", "y", "foo"};
+const char *const UnOps[] = {"-", "+", "!"};
+const char *const BinOps[] = {"+",  "-",  "*",  "/",  "%",  "<", ">",
+                              "<=", ">=", "==", "!=", "&&", "||"};
+const char *const Inserted[] = {"(", ")",    "{",   "}",    ";",     "=",
+                                "+", "else", "let", "if",   "while", "x",
+                                "3", ",",    "@",   "func"};
+const char *const Replacing[] = {";", "}", "(", "==", "print"};
+const unsigned NestedParens = 50000;
+
+class ProgramGen final {
+  // Only the raw engine output is portable, the distributions are not.
+  std::mt19937 Rand;
+  std::vector<std::string> Toks;
+
+  unsigned pick(unsigned N) { return Rand() % N; }
+  template <unsigned N> const char *pick(const char *const (&Choices)[N]) {
+    return Choices[pick(N)];
+  }
+  void emit(std::string Tok) { Toks.push_back(std::move(Tok)); }
+
+  void genExpr(unsigned Depth);
+  void genBlock(unsigned Depth);
+  void genFunc();
+
+public:
+  explicit ProgramGen(unsigned Seed) : Rand(Seed) {}
+  std::vector<std::string> genProgram();
+  void mutate(std::vector<std::string> &Program);
+};
+
+void ProgramGen::genExpr(unsigned Depth) {
+  if (!Depth) {
+    switch (pick(3)) {
+    case 0:
+      return emit(pick(Idents));
+    case 1:
+      return emit(std::to_string(pick(100)));
+    default:
+      return emit("?");
+    }
+  }
+  switch (pick(10)) {
+  case 0:
+    emit("(");
+    genExpr(Depth - 1);
+    return emit(")");
+  case 1:
+    emit("print");
+    return genExpr(Depth - 1);
+  case 2:
+    emit(pick(Idents));
+    emit("=");
+    return genExpr(Depth - 1);
+  case 3:
+    emit(pick(UnOps));
+    return genExpr(Depth - 1);
+  case 4: {
+    emit(pick(Idents));
+    emit("(");
+    unsigned NArgs = pick(4);
+    for (unsigned I = 0; I < NArgs; ++I) {
+      if (I)
+        emit(",");
+      genExpr(Depth - 1);
+    }
+    return emit(")");
+  }
+  default:
+    genExpr(Depth - 1);
+    emit(pick(BinOps));
+    return genExpr(Depth - 1);
+  }
+}
+
+void ProgramGen::genBlock(unsigned Depth) {
+  switch (pick(Depth ? 9 : 5)) {
+  case 0:
+  case 1:
+    genExpr(3);
+    return emit(";");
+  case 2:
+    return emit(";");
+  case 3:
+    emit("let");
+    emit(pick(Idents));
+    genExpr(3);
+    return emit(";");
+  case 4:
+    emit("return");
+    genExpr(3);
+    return emit(";");
+  case 5: {
+    emit("{");
+    unsigned NBlocks = pick(4);
+    for (unsigned I = 0; I < NBlocks; ++I)
+      genBlock(Depth - 1);
+    return emit("}");
+  }
+  case 6:
+    emit("while");
+    emit("(");
+    genExpr(2);
+    emit(")");
+    return genBlock(Depth - 1);
+  default:
+    emit("if");
+    emit("(");
+    genExpr(2);
+    emit(")");
+    genBlock(Depth - 1);
+    if (pick(2))
+      return;
+    emit("else");
+    return genBlock(Depth - 1);
+  }
+}
+
+void ProgramGen::genFunc() {
+  emit("func");
+  emit(pick(Idents));
+  emit("(");
+  unsigned NArgs = pick(4);
+  for (unsigned I = 0; I < NArgs; ++I) {
+    if (I)
+      emit(",");
+    emit(pick(Idents));
+  }
+  emit(")");
+  emit("{");
+  unsigned NBlocks = pick(6);
+  for (unsigned I = 0; I < NBlocks; ++I)
+    genBlock(3);
+  emit("}");
+}
+
+std::vector<std::string> ProgramGen::genProgram() {
+  Toks.clear();
+  unsigned NFuncs = 1 + pick(3);
+  for (unsigned I = 0; I < NFuncs; ++I)
+    genFunc();
+  return std::move(Toks);
+}
+
+void ProgramGen::mutate(std::vector<std::string> &Program) {
+  unsigned NMutations = 1 + pick(3);
+  for (unsigned I = 0; I < NMutations; ++I) {
+    auto Pos = Program.begin() + pick(Program.size());
+    switch (pick(3)) {
+    case 0:
+      Program.erase(Pos);
+      break;
+    case 1:
+      Program.insert(Pos, pick(Inserted));
+      break;
+    default:
+      *Pos = pick(Replacing);
+      break;
+    }
+  }
+}
+
+bool writeProgram(const std::string &Path,
+                  const std::vector<std::string> &Program) {
+  std::ofstream File{Path};
+  for (const auto &Tok : Program) {
+    File << Tok;
+    File << (Tok == ";" || Tok == "{" || Tok == "}" ? '\n' : ' ');
+  }
+  return static_cast<bool>(File);
+}
+
+std::vector<std::string> genNested() {
+  std::vector<std::string> Toks{"func", "main", "(", ")", "{", "x", "="};
+  Toks.insert(Toks.end(), NestedParens, "(");
+  Toks.push_back("1");
+  Toks.insert(Toks.end(), NestedParens, ")");
+  Toks.insert(Toks.end(), {";", "}"});
+  return Toks;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " <directory> <count>\n";
+    return 1;
+  }
+  std::string Dir = argv[1];
+  unsigned Count = std::strtoul(argv[2], nullptr, 10);
+  for (unsigned N = 0; N < Count; ++N) {
+    ProgramGen Gen{N};
+    auto Program = Gen.genProgram();
+    auto Name = std::to_string(N) + ".mylang";
+    bool Written = writeProgram(Dir + "/valid-" + Name, Program);
+    Gen.mutate(Program);
+    if (!Written || !writeProgram(Dir + "/mutated-" + Name, Program)) {
+      std::cerr << "Error: cannot write programs to " << Dir << "\n";
+      return 1;
+    }
+  }
+  if (!writeProgram(Dir + "/nested.mylang", genNested())) {
+    std::cerr << "Error: cannot write programs to " << Dir << "\n";
+    return 1;
+  }
+}